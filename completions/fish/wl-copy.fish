@@ -13,7 +13,9 @@ end
 complete -c wl-copy -x
 complete -c wl-copy -s h -l help -d 'Display a help message'
 complete -c wl-copy -s v -l version -d 'Display version info'
+complete -c wl-copy -l trace -d 'Print each phase of the operation to stderr'
 complete -c wl-copy -s o -l paste-once -d 'Only serve one paste request and then exit'
+complete -c wl-copy -l early-detach -d 'Fork before reading the data and setting the selection'
 complete -c wl-copy -s c -l clear -d 'Instead of copying anything, clear the clipboard'
 complete -c wl-copy -s p -l primary -d 'Use the "primary" clipboard'
 complete -c wl-copy -s n -l trim-newline -d 'Do not copy the trailing newline character'
@@ -15,6 +15,8 @@ function __wl_paste_types --description 'Print types with context'
     for i in (seq (count $type))
         if [ "$type[$i]" = '--primary' ]; or [ "$type[$i]" = '-p' ]
             set clip "primary"
+        else if [ "$type[$i]" = '--selection' ]; and [ "$type[(math $i + 1)]" = 'primary' ]
+            set clip "primary"
         else if [ "$type[$i]" = '--seat' ]; or [ "$type[$i]" = '-s' ]
             set seat $type[(math $i + 1)]
         end
@@ -35,12 +37,31 @@ function __wl_paste_types --description 'Print types with context'
 end
 
 complete -c wl-paste -f
-complete -c wl-paste -f -n '__fish_contains_opt -s w watch' -a "(__fish_complete_subcommand -- -s --seat -t --type)"
-complete -c wl-paste -n '__fish_not_contain_opt -s w watch' -s h -l help -d 'Display a help message'
-complete -c wl-paste -n '__fish_not_contain_opt -s w watch' -s v -l version -d 'Display version info'
-complete -c wl-paste -n '__fish_not_contain_opt -s w watch' -s n -l no-newline -d 'Do not append a newline character'
-complete -c wl-paste -n '__fish_not_contain_opt -s w watch' -s l -l list-types -d 'Instead of pasting, list the offered types'
-complete -c wl-paste -n '__fish_not_contain_opt -s w watch' -s p -l primary -d 'Use the "primary" clipboard'
-complete -c wl-paste -n '__fish_not_contain_opt -s w watch' -s w -l watch -d 'Run a command each time the selection changes'
-complete -c wl-paste -n '__fish_not_contain_opt -s w watch' -s t -l type -x -d 'Override the inferred MIME type for the content' -a "(__wl_paste_types)"
-complete -c wl-paste -n '__fish_not_contain_opt -s w watch' -s s -l seat -x -d 'Pick the seat to work with' -a "(__wayland_seats)"
+complete -c wl-paste -f -n '__fish_contains_opt -s w watch watch-coproc' -a "(__fish_complete_subcommand -- -s --seat -t --type)"
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -s h -l help -d 'Display a help message'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -s v -l version -d 'Display version info'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l trace -d 'Print each phase of the operation to stderr'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -s n -l no-newline -d 'Do not append a newline character'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -s l -l list-types -d 'Instead of pasting, list the offered types'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -s p -l primary -d 'Use the "primary" clipboard'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l selection -x -d 'Pick the selection to use' -a 'clipboard primary both'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -s w -l watch -d 'Run a command each time the selection changes'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -s t -l type -x -d 'Override the inferred MIME type for the content' -a "(__wl_paste_types)"
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -s s -l seat -x -d 'Pick the seat to work with' -a "(__wayland_seats)"
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -s s -l seat -x -a '\\*' -d 'All the seats, in watch mode'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-append -r -F -d 'Append each new selection to a file'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-separator -x -d 'Separator to write after each selection'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-socket -r -F -d 'Write each new selection to a socket or FIFO'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-coproc -d 'Write each new selection to a command spawned once'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l debounce -x -d 'Only handle selections that stay unchanged for a while'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l coalesce -d 'Skip selections already replaced by a newer one'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-jobs -x -d 'Run up to this many commands at the same time'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-queue -x -d 'What to do with selections while commands run' -a 'queue drop-oldest latest'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-no-data -d 'Spawn the command without receiving the contents'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-json -d 'Print a JSON object for each new selection'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-json-inline -x -d 'Include text up to this size in the JSON'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-dedup -d 'Skip selections with the same contents as the last one'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-if-type -x -d 'Skip selections not offered in a matching type' -a "(__wl_paste_types)"
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-if-match -x -d 'Skip selections whose contents do not match'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-max-size -x -d 'Skip selections larger than this'
+complete -c wl-paste -n '__fish_not_contain_opt -s w watch watch-coproc' -l watch-memfd -d 'Pass the contents to the command in a sealed memory file'
@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+
+# wl-clipboard
+#
+# Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Generates a C header with a perfect hash table of the MIME types known
+# to shared-mime-info, recording for each one whether it descends from
+# text/plain, or else which type it is an alias of. MIME types are case
+# insensitive, so the table is keyed by lowercase names.
+#
+# Usage: generate-mime-table.py output.h output.d [mime-dir...]
+#
+# The first of the given directories that contains shared-mime-info data
+# is used. If there is none, an empty table is generated. The files that
+# have been read are listed in output.d, in the Makefile dependency format,
+# so that the table gets regenerated when the data changes.
+
+import os
+import sys
+
+# Must match mime_table_hash() in src/util/mime-table.c
+def mime_table_hash(data, seed):
+    h = (0x811c9dc5 ^ seed) & 0xffffffff
+    for byte in data:
+        h ^= byte
+        h = (h * 0x01000193) & 0xffffffff
+    # Finalize to spread the bits
+    h ^= h >> 16
+    h = (h * 0x85ebca6b) & 0xffffffff
+    h ^= h >> 13
+    h = (h * 0xc2b2ae35) & 0xffffffff
+    h ^= h >> 16
+    return h
+
+
+def read_pairs(path):
+    pairs = []
+    with open(path, encoding='utf-8') as f:
+        for line in f:
+            words = line.split()
+            if len(words) == 2:
+                pairs.append(words)
+    return pairs
+
+
+def load(mime_dir):
+    with open(os.path.join(mime_dir, 'types'), encoding='utf-8') as f:
+        types = [line.strip() for line in f if line.strip()]
+    parents = {}
+    for child, parent in read_pairs(os.path.join(mime_dir, 'subclasses')):
+        parents.setdefault(child, []).append(parent)
+    aliases = dict(read_pairs(os.path.join(mime_dir, 'aliases')))
+    return types, parents, aliases
+
+
+def compute_is_text(types, parents):
+    is_text = {}
+
+    def visit(mime_type, seen):
+        if mime_type in is_text:
+            return is_text[mime_type]
+        if mime_type.startswith('text/'):
+            # All text/* types implicitly descend from text/plain
+            return True
+        if mime_type in seen:
+            return False
+        seen.add(mime_type)
+        return any(visit(p, seen) for p in parents.get(mime_type, []))
+
+    for mime_type in types:
+        is_text[mime_type] = visit(mime_type, set())
+    return is_text
+
+
+def key_for(mime_type):
+    # Only lowercase ASCII letters, as mime_table_lookup() does
+    return mime_type.encode().lower().decode()
+
+
+def build_perfect_hash(keys):
+    # Hash and displace: first hash each key into a bucket,
+    # then for each bucket (biggest first) find a seed that
+    # places all of its keys into free slots.
+    size = len(keys)
+    bucket_count = max(1, (size + 3) // 4)
+    buckets = [[] for _ in range(bucket_count)]
+    for key in keys:
+        buckets[mime_table_hash(key.encode(), 0) % bucket_count].append(key)
+
+    slots = [None] * size
+    seeds = [0] * bucket_count
+    order = sorted(range(bucket_count), key=lambda b: -len(buckets[b]))
+    for b in order:
+        if not buckets[b]:
+            continue
+        seed = 1
+        while True:
+            indices = [
+                mime_table_hash(key.encode(), seed) % size
+                for key in buckets[b]
+            ]
+            if len(set(indices)) == len(indices) and \
+                    all(slots[i] is None for i in indices):
+                break
+            seed += 1
+        seeds[b] = seed
+        for key, index in zip(buckets[b], indices):
+            slots[index] = key
+    return seeds, slots
+
+
+def c_string(s):
+    if s is None:
+        return 'NULL'
+    return '"' + s.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def write_depfile(path, output, mime_dir):
+    inputs = []
+    if mime_dir is not None:
+        inputs = [
+            os.path.join(mime_dir, name)
+            for name in ('types', 'subclasses', 'aliases')
+        ]
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write('{}: {}\n'.format(
+            output.replace(' ', '\\ '),
+            ' '.join(i.replace(' ', '\\ ') for i in inputs)
+        ))
+
+
+def main():
+    output = sys.argv[1]
+    depfile = sys.argv[2]
+    mime_dir = None
+    for candidate in sys.argv[3:]:
+        if os.path.exists(os.path.join(candidate, 'subclasses')):
+            mime_dir = candidate
+            break
+
+    entries = {}
+    if mime_dir is not None:
+        types, parents, aliases = load(mime_dir)
+        is_text = compute_is_text(types, parents)
+        for mime_type in types:
+            entries.setdefault(key_for(mime_type), (None, is_text[mime_type]))
+        # Aliases get resolved to their canonical types at
+        # runtime, so there's nothing to compute for them
+        for alias, canonical in aliases.items():
+            entries.setdefault(key_for(alias), (canonical, False))
+
+    keys = sorted(entries)
+    seeds, slots = build_perfect_hash(keys)
+
+    lines = [
+        '/* Generated by generate-mime-table.py, do not edit */',
+        '',
+        '#define MIME_TABLE_SIZE {}'.format(len(keys)),
+        '#define MIME_TABLE_BUCKET_COUNT {}'.format(len(seeds)),
+        '',
+    ]
+    write_depfile(depfile, output, mime_dir)
+    if not keys:
+        # Don't emit the arrays at all, mime-table.c
+        # doesn't look at them if the table is empty
+        with open(output, 'w', encoding='utf-8') as f:
+            f.write('\n'.join(lines))
+        return
+
+    lines += [
+        'static const uint32_t mime_table_seeds[] = {',
+    ]
+    lines += ['    {},'.format(seed) for seed in seeds]
+    lines += [
+        '};',
+        '',
+        'static const struct mime_table_entry mime_table_entries[] = {',
+    ]
+    for key in slots:
+        alias_of, text = entries[key]
+        lines.append('    {{ {}, {}, {} }},'.format(
+            c_string(key), c_string(alias_of), int(text)
+        ))
+    lines += ['};', '']
+
+    with open(output, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(lines))
+
+
+if __name__ == '__main__':
+    main()
@@ -22,6 +22,9 @@
 #include "types/popup-surface.h"
 
 #include "util/misc.h"
+#include "util/trace.h"
+#include "util/metrics.h"
+#include "util/probes.h"
 
 #include <stdint.h>
 #include <string.h>
@@ -31,6 +34,8 @@
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <time.h>
+#include <sys/stat.h>
 
 static void do_set_selection(struct copy_action *self, uint32_t serial) {
     /* Set the selection and make sure it reaches
@@ -44,7 +49,10 @@ static void do_set_selection(struct copy_action *self, uint32_t serial) {
         self->popup_surface->data = NULL;
     }
     device_set_selection(self->device, self->source, serial, self->primary);
+    PROBE(roundtrip_begin);
     wl_display_roundtrip(self->device->wl_display);
+    PROBE(roundtrip_end);
+    trace("selection-set", NULL);
 
     /* Now, if we have used a popup surface, destroy it */
     if (self->popup_surface != NULL) {
@@ -68,6 +76,17 @@ static void on_focus(
 
 static void do_send(struct source *source, const char *mime_type, int fd) {
     struct copy_action *self = source->data;
+    trace("send", "type=%s", mime_type);
+    PROBE2(send_begin, mime_type, fd);
+    /* All the ways out of here go through the end of
+     * the function, so that every send_begin probe is
+     * matched by a send_end one.
+     */
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t bytes = 0;
+    int is_paste = 1;
+    int sent = 0;
 
     /* Unset O_NONBLOCK */
     fcntl(fd, F_SETFL, 0);
@@ -80,10 +99,11 @@ static void do_send(struct source *source, const char *mime_type, int fd) {
         const char *data = self->sensitive ? "secret" : "public";
         write(fd, data, strlen(data));
         close(fd);
-        /* This does not count as pasting, so don't invoke
-         * our pasted_callback, just return.
+        /* This does not count as pasting, so don't record
+         * it or invoke our pasted_callback.
          */
-        return;
+        is_paste = 0;
+        goto out;
     }
 
     if (self->fd_to_copy_from != -1) {
@@ -94,7 +114,7 @@ static void do_send(struct source *source, const char *mime_type, int fd) {
         if (pid < 0) {
             perror("fork");
             close(fd);
-            return;
+            goto out;
         }
         if (pid == 0) {
             dup2(self->fd_to_copy_from, STDIN_FILENO);
@@ -105,7 +125,7 @@ static void do_send(struct source *source, const char *mime_type, int fd) {
             signal(SIGPIPE, SIG_DFL);
             execlp("cat", "cat", NULL);
             perror("exec cat");
-            exit(1);
+            _exit(1);
         }
         close(fd);
         /* Wait for the cat process to exit. This effectively
@@ -115,7 +135,13 @@ static void do_send(struct source *source, const char *mime_type, int fd) {
          * should switch to an asynchronous child waiting scheme
          * instead.
          */
-        waitpid(pid, NULL, 0);
+        int wstatus;
+        waitpid(pid, &wstatus, 0);
+        struct stat st;
+        int copied = WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0;
+        if (copied && fstat(self->fd_to_copy_from, &st) == 0) {
+            bytes = st.st_size;
+        }
         /* Seek back to the beginning of the file */
         off_t rc = lseek(self->fd_to_copy_from, 0, SEEK_SET);
         if (rc < 0) {
@@ -127,12 +153,17 @@ static void do_send(struct source *source, const char *mime_type, int fd) {
         if (f == NULL) {
             perror("fdopen");
             close(fd);
-            return;
+            goto out;
         }
 
         if (self->data_to_copy.ptr != NULL) {
             /* Just copy the given chunk of data */
-            fwrite(self->data_to_copy.ptr, 1, self->data_to_copy.len, f);
+            bytes = fwrite(
+                self->data_to_copy.ptr,
+                1,
+                self->data_to_copy.len,
+                f
+            );
         } else if (self->argv_to_copy != NULL) {
             /* Copy an argv-style string array,
              * inserting spaces between items.
@@ -140,10 +171,10 @@ static void do_send(struct source *source, const char *mime_type, int fd) {
             int is_first = 1;
             for (argv_t word = self->argv_to_copy; *word != NULL; word++) {
                 if (!is_first) {
-                    fwrite(" ", 1, 1, f);
+                    bytes += fwrite(" ", 1, 1, f);
                 }
                 is_first = 0;
-                fwrite(*word, 1, strlen(*word), f);
+                bytes += fwrite(*word, 1, strlen(*word), f);
             }
         } else {
             bail("Unreachable: nothing to copy");
@@ -151,9 +182,20 @@ static void do_send(struct source *source, const char *mime_type, int fd) {
 
         fclose(f);
     }
+    trace("sent", "type=%s", mime_type);
+    sent = 1;
+
+out:
+    if (is_paste) {
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double duration_ms = (end.tv_sec - start.tv_sec) * 1e3
+            + (end.tv_nsec - start.tv_nsec) / 1e6;
+        metrics_transfer_finished(mime_type, bytes, duration_ms);
+    }
+    PROBE2(send_end, mime_type, bytes);
 
-
-    if (self->pasted_callback != NULL) {
+    if (sent && self->pasted_callback != NULL) {
         self->pasted_callback(self);
     }
 }
@@ -63,8 +63,9 @@ static struct device *device_manager_ ## type ## _do_get_device( \
     return device; \
 }
 
-#define INIT(type) \
+#define INIT(type, backend_name) \
 void device_manager_init_ ## type(struct device_manager *self) { \
+    self->name = backend_name; \
     self->do_create_source = device_manager_ ## type ## _do_create_source; \
     self->do_get_device = device_manager_ ## type ## _do_get_device; \
 }
@@ -74,7 +75,7 @@ void device_manager_init_ ## type(struct device_manager *self) { \
 
 CREATE_SOURCE(wl_data_device_manager, wl_data_source, create_data_source)
 GET_DEVICE(wl_data_device_manager, wl_data_device, get_data_device)
-INIT(wl_data_device_manager)
+INIT(wl_data_device_manager, "core")
 
 
 /* gtk-primary-selection implementation */
@@ -93,7 +94,7 @@ GET_DEVICE(
     get_device
 )
 
-INIT(gtk_primary_selection_device_manager)
+INIT(gtk_primary_selection_device_manager, "gtk")
 
 #endif /* HAVE_GTK_PRIMARY_SELECTION */
 
@@ -114,7 +115,7 @@ GET_DEVICE(
     get_device
 )
 
-INIT(zwp_primary_selection_device_manager_v1)
+INIT(zwp_primary_selection_device_manager_v1, "wp")
 
 #endif /* HAVE_WP_PRIMARY_SELECTION */
 
@@ -135,7 +136,7 @@ GET_DEVICE(
     get_data_device
 )
 
-INIT(zwlr_data_control_manager_v1)
+INIT(zwlr_data_control_manager_v1, "wlr")
 
 #endif /* HAVE_WLR_DATA_CONTROL */
 
@@ -155,6 +156,6 @@ GET_DEVICE(
     get_data_device
 )
 
-INIT(ext_data_control_manager_v1)
+INIT(ext_data_control_manager_v1, "ext")
 
 #endif /* HAVE_EXT_DATA_CONTROL */
@@ -33,6 +33,8 @@ struct device_manager {
     struct wl_display *wl_display;
 
     /* These fields are initialized by the implementation */
+    /* A short name of the protocol, for diagnostics */
+    const char *name;
     struct source *(*do_create_source)(struct device_manager *self);
     struct device *(*do_get_device)(
         struct device_manager *self,
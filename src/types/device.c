@@ -22,6 +22,8 @@
 #include "types/source.h"
 #include "includes/selection-protocols.h"
 
+#include "util/probes.h"
+
 #include <wayland-client.h>
 #include <stdlib.h>
 
@@ -44,6 +46,11 @@ void device_set_selection(
     self->do_set_selection(self, source, serial, primary);
 }
 
+void device_destroy(struct device *self) {
+    self->do_destroy(self->proxy);
+    free(self);
+}
+
 /* Macros to reduce implementation boilerplate */
 
 #define SUPPORTS_SELECTION(type, expr) \
@@ -95,8 +102,9 @@ static void type ## _ ## selection_event ## _handler( \
     if (offer_proxy != NULL) { \
         offer = wl_proxy_get_user_data((struct wl_proxy *) offer_proxy); \
     } \
+    PROBE2(selection_event, offer, primary); \
     if (self->selection_callback) { \
-        self->selection_callback(offer, primary); \
+        self->selection_callback(self, offer, primary); \
     } \
 }
 
@@ -107,6 +115,7 @@ void device_init_ ## type(struct device *self) { \
     self->supports_selection = device_supports_selection_on_ ## type; \
     self->needs_popup_surface = needs_surface; \
     self->do_set_selection = device_set_selection_on_ ## type; \
+    self->do_destroy = (void (*)(struct wl_proxy *)) type ## _destroy; \
 }
 
 
@@ -214,7 +223,9 @@ static int device_get_wlr_supports_selection(struct device *self, int primary) {
         return 0;
     }
 
+    PROBE(roundtrip_begin);
     wl_display_roundtrip(self->wl_display);
+    PROBE(roundtrip_end);
 
     if (device_wlr_supports_primary_selection == Yes) {
         return 1;
@@ -258,7 +269,7 @@ static void zwlr_data_control_device_v1_primary_selection_handler(
         offer = wl_proxy_get_user_data((struct wl_proxy *) offer_proxy);
     }
     if (self->selection_callback != NULL) {
-        self->selection_callback(offer, 1);
+        self->selection_callback(self, offer, 1);
     }
 }
 
@@ -291,7 +302,9 @@ static int device_get_ext_supports_selection(struct device *self, int primary) {
         return 0;
     }
 
+    PROBE(roundtrip_begin);
     wl_display_roundtrip(self->wl_display);
+    PROBE(roundtrip_end);
 
     if (device_ext_supports_primary_selection == Yes) {
         return 1;
@@ -335,7 +348,7 @@ static void ext_data_control_device_v1_primary_selection_handler(
         offer = wl_proxy_get_user_data((struct wl_proxy *) offer_proxy);
     }
     if (self->selection_callback != NULL) {
-        self->selection_callback(offer, 1);
+        self->selection_callback(self, offer, 1);
     }
 }
 
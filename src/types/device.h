@@ -29,7 +29,11 @@ struct source;
 struct device {
     /* These fields are initialized by the creator */
     void (*new_offer_callback)(struct offer *offer);
-    void (*selection_callback)(struct offer *offer, int primary);
+    void (*selection_callback)(
+        struct device *self,
+        struct offer *offer,
+        int primary
+    );
     void *data;
 
     struct wl_proxy *proxy;
@@ -44,6 +48,7 @@ struct device {
         uint32_t serial,
         int primary
     );
+    void (*do_destroy)(struct wl_proxy *proxy);
 };
 
 int device_supports_selection(struct device *self, int primary);
@@ -55,6 +60,8 @@ void device_set_selection(
     int primary
 );
 
+void device_destroy(struct device *self);
+
 /* Initializers */
 
 void device_init_wl_data_device(struct device *self);
@@ -0,0 +1,148 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types/event-loop.h"
+
+#include <wayland-client.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdlib.h>
+
+struct watch {
+    int fd;
+    void (*callback)(void *data, int fd);
+    void *data;
+};
+
+void event_loop_init(struct event_loop *self) {
+    wl_array_init(&self->watches);
+}
+
+void event_loop_add_fd(
+    struct event_loop *self,
+    int fd,
+    void (*callback)(void *data, int fd),
+    void *data
+) {
+    struct watch *watch = wl_array_add(&self->watches, sizeof(struct watch));
+    watch->fd = fd;
+    watch->callback = callback;
+    watch->data = data;
+}
+
+void event_loop_remove_fd(struct event_loop *self, int fd) {
+    struct watch *watch;
+    wl_array_for_each(watch, &self->watches) {
+        if (watch->fd == fd) {
+            /* Mark it as removed; we might be
+             * in the middle of dispatching.
+             */
+            watch->fd = -1;
+        }
+    }
+}
+
+static struct watch *find_watch(struct event_loop *self, int fd) {
+    struct watch *watch;
+    wl_array_for_each(watch, &self->watches) {
+        if (watch->fd == fd) {
+            return watch;
+        }
+    }
+    return NULL;
+}
+
+static void compact_watches(struct event_loop *self) {
+    struct watch *watches = self->watches.data;
+    size_t count = self->watches.size / sizeof(struct watch);
+    size_t new_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (watches[i].fd >= 0) {
+            watches[new_count++] = watches[i];
+        }
+    }
+    self->watches.size = new_count * sizeof(struct watch);
+}
+
+int event_loop_dispatch(struct event_loop *self, int timeout) {
+    struct wl_display *wl_display = self->wl_display;
+
+    compact_watches(self);
+    size_t count = self->watches.size / sizeof(struct watch);
+    struct pollfd *pollfds = calloc(count + 1, sizeof(struct pollfd));
+    pollfds[0].fd = wl_display_get_fd(wl_display);
+    pollfds[0].events = POLLIN;
+    struct watch *watches = self->watches.data;
+    for (size_t i = 0; i < count; i++) {
+        pollfds[i + 1].fd = watches[i].fd;
+        pollfds[i + 1].events = POLLIN;
+    }
+
+    /* This is the usual dance of reading
+     * Wayland events from our own poll().
+     */
+    while (wl_display_prepare_read(wl_display) != 0) {
+        if (wl_display_dispatch_pending(wl_display) < 0) {
+            free(pollfds);
+            return -1;
+        }
+    }
+    if (wl_display_flush(wl_display) < 0 && errno != EAGAIN) {
+        wl_display_cancel_read(wl_display);
+        free(pollfds);
+        return -1;
+    }
+
+    int rc = poll(pollfds, count + 1, timeout);
+    if (rc < 0) {
+        wl_display_cancel_read(wl_display);
+        free(pollfds);
+        return errno == EINTR ? 0 : -1;
+    }
+
+    if (pollfds[0].revents != 0) {
+        if (wl_display_read_events(wl_display) < 0) {
+            free(pollfds);
+            return -1;
+        }
+    } else {
+        wl_display_cancel_read(wl_display);
+    }
+    int dispatched = wl_display_dispatch_pending(wl_display);
+    if (dispatched < 0) {
+        free(pollfds);
+        return -1;
+    }
+
+    /* The callbacks may add or remove watches,
+     * so look each one up again before invoking it.
+     */
+    for (size_t i = 1; i <= count; i++) {
+        if (pollfds[i].revents == 0) {
+            continue;
+        }
+        struct watch *watch = find_watch(self, pollfds[i].fd);
+        if (watch != NULL) {
+            watch->callback(watch->data, watch->fd);
+            dispatched++;
+        }
+    }
+
+    free(pollfds);
+    return dispatched;
+}
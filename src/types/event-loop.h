@@ -0,0 +1,55 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TYPES_EVENT_LOOP_H
+#define TYPES_EVENT_LOOP_H
+
+#include <wayland-util.h>
+
+struct wl_display;
+
+/* Dispatches Wayland events, along with
+ * events on other file descriptors.
+ */
+struct event_loop {
+    /* These fields are initialized by the creator */
+    struct wl_display *wl_display;
+
+    /* These fields are initialized by event_loop_init() */
+    struct wl_array watches;
+};
+
+void event_loop_init(struct event_loop *self);
+
+/* The callback gets invoked when the fd becomes readable */
+void event_loop_add_fd(
+    struct event_loop *self,
+    int fd,
+    void (*callback)(void *data, int fd),
+    void *data
+);
+
+void event_loop_remove_fd(struct event_loop *self, int fd);
+
+/* Waits for and dispatches events. A negative timeout
+ * (in milliseconds) means to wait indefinitely. Returns
+ * the number of events dispatched, or -1 on error.
+ */
+int event_loop_dispatch(struct event_loop *self, int timeout);
+
+#endif /* TYPES_EVENT_LOOP_H */
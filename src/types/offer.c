@@ -19,17 +19,84 @@
 #include "types/offer.h"
 #include "includes/selection-protocols.h"
 
+#include "util/probes.h"
+
 #include <wayland-util.h>
 #include <stdlib.h>
 #include <string.h>
 
+size_t offer_get_mime_type_count(struct offer *self) {
+    return self->offered_atoms.size / sizeof(atom_t);
+}
+
+atom_t offer_get_atom(struct offer *self, size_t index) {
+    const atom_t *atoms = self->offered_atoms.data;
+    return atoms[index];
+}
+
+static size_t atom_set_slot(atom_t atom, size_t capacity) {
+    /* Fibonacci hashing */
+    return (atom * 2654435761u) & (capacity - 1);
+}
+
+int offer_has_atom(struct offer *self, atom_t atom) {
+    if (self->atom_set == NULL || atom == ATOM_NONE) {
+        return 0;
+    }
+    size_t mask = self->atom_set_capacity - 1;
+    size_t index = atom_set_slot(atom, self->atom_set_capacity);
+    for (; self->atom_set[index] != ATOM_NONE; index = (index + 1) & mask) {
+        if (self->atom_set[index] == atom) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void atom_set_insert(struct offer *self, atom_t atom) {
+    size_t mask = self->atom_set_capacity - 1;
+    size_t index = atom_set_slot(atom, self->atom_set_capacity);
+    for (; self->atom_set[index] != ATOM_NONE; index = (index + 1) & mask) {
+        if (self->atom_set[index] == atom) {
+            return;
+        }
+    }
+    self->atom_set[index] = atom;
+}
+
+static void add_atom(struct offer *self, atom_t atom) {
+    atom_t *ptr = wl_array_add(&self->offered_atoms, sizeof(atom_t));
+    *ptr = atom;
+
+    /* Keep the load factor below one half */
+    size_t count = offer_get_mime_type_count(self);
+    if (count * 2 > self->atom_set_capacity) {
+        free(self->atom_set);
+        self->atom_set_capacity = self->atom_set_capacity != 0
+            ? self->atom_set_capacity * 2
+            : 16;
+        self->atom_set = calloc(self->atom_set_capacity, sizeof(atom_t));
+        for (size_t i = 0; i < count; i++) {
+            atom_set_insert(self, offer_get_atom(self, i));
+        }
+    } else {
+        atom_set_insert(self, atom);
+    }
+}
+
 void offer_receive(struct offer *self, const char *mime_type, int fd) {
     self->do_receive(self->proxy, mime_type, fd);
 }
 
 void offer_destroy(struct offer *self) {
     self->do_destroy(self->proxy);
+    /* Each offered type holds a reference to its atom */
+    for (size_t i = 0; i < offer_get_mime_type_count(self); i++) {
+        atom_release(offer_get_atom(self, i));
+    }
     wl_array_release(&self->offered_mime_types);
+    wl_array_release(&self->offered_atoms);
+    free(self->atom_set);
     free(self);
 }
 
@@ -43,11 +110,13 @@ static void type ## _offer_handler( \
     const char *mime_type \
 ) { \
     struct offer *self = data; \
+    PROBE1(offer, mime_type); \
     char *ptr = wl_array_add( \
         &self->offered_mime_types, \
         strlen(mime_type) + 1 \
     ); \
     strcpy(ptr, mime_type); \
+    add_atom(self, atom_intern(mime_type)); \
 }
 
 #define LISTENER(type) \
@@ -61,6 +130,9 @@ void offer_init_ ## type(struct offer *self) { \
         (void (*)(struct wl_proxy *, const char *, int)) type ## _receive; \
     self->do_destroy = (void (*)(struct wl_proxy *)) type ## _destroy; \
     wl_array_init(&self->offered_mime_types); \
+    wl_array_init(&self->offered_atoms); \
+    self->atom_set = NULL; \
+    self->atom_set_capacity = 0; \
     struct type *proxy = (struct type *) self->proxy; \
     type ## _add_listener(proxy, &type ## _listener, self); \
 }
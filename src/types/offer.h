@@ -20,6 +20,7 @@
 #define TYPES_OFFER_H
 
 #include "includes/selection-protocols.h"
+#include "util/atom.h"
 
 #include <wayland-util.h>
 #include <string.h>
@@ -32,6 +33,13 @@ struct offer {
     void (*do_receive)(struct wl_proxy *proxy, const char *mime_type, int fd);
     void (*do_destroy)(struct wl_proxy *proxy);
     struct wl_array offered_mime_types;
+    /* The same types, interned, in the order they were offered */
+    struct wl_array offered_atoms;
+    /* An open-addressing hash set of the offered atoms,
+     * with ATOM_NONE marking empty slots.
+     */
+    atom_t *atom_set;
+    size_t atom_set_capacity;
 };
 
 #define offer_for_each_mime_type(offer, mime_type) \
@@ -42,6 +50,10 @@ for ( \
     mime_type += strlen(mime_type) + 1 \
 )
 
+size_t offer_get_mime_type_count(struct offer *self);
+atom_t offer_get_atom(struct offer *self, size_t index);
+int offer_has_atom(struct offer *self, atom_t atom);
+
 void offer_receive(struct offer *self, const char *mime_type, int fd);
 void offer_destroy(struct offer *self);
 
@@ -24,6 +24,7 @@
 #include "types/shell-surface.h"
 #include "util/files.h"
 #include "util/misc.h"
+#include "util/probes.h"
 
 #include <stdint.h>
 #include <stdlib.h>
@@ -45,6 +46,15 @@ void popup_surface_init(struct popup_surface *self) {
         complain_about_missing_shell();
     }
 
+    /* We need to know the seat capabilities
+     * to find out whether it has a keyboard.
+     */
+    if (!self->seat->has_capabilities) {
+        PROBE(roundtrip_begin);
+        wl_display_roundtrip(self->registry->wl_display);
+        PROBE(roundtrip_end);
+    }
+
     self->keyboard = seat_get_keyboard(self->seat);
     if (self->keyboard == NULL) {
         bail("This seat has no keyboard");
@@ -59,7 +69,8 @@ void popup_surface_init(struct popup_surface *self) {
     wl_display_dispatch(self->registry->wl_display);
 
 
-    struct wl_compositor *wl_compositor = self->registry->wl_compositor;
+    struct wl_compositor *wl_compositor
+        = registry_get_wl_compositor(self->registry);
     if (wl_compositor == NULL) {
         complain_about_missing_global("wl_compositor");
     }
@@ -70,9 +81,10 @@ void popup_surface_init(struct popup_surface *self) {
     );
 
 #ifdef HAVE_GTK_SHELL
-    if (self->registry->gtk_shell1 != NULL) {
+    struct gtk_shell1 *gtk_shell1 = registry_get_gtk_shell1(self->registry);
+    if (gtk_shell1 != NULL) {
         self->gtk_surface = gtk_shell1_get_gtk_surface(
-            self->registry->gtk_shell1,
+            gtk_shell1,
             self->wl_surface
         );
     }
@@ -80,7 +92,9 @@ void popup_surface_init(struct popup_surface *self) {
 
     /* Signal that the surface is ready to be configured */
     wl_surface_commit(self->wl_surface);
+    PROBE(roundtrip_begin);
     wl_display_roundtrip(self->registry->wl_display);
+    PROBE(roundtrip_end);
 
     if (self->wl_surface == NULL) {
         /* It's possible that we were given focus
@@ -112,7 +126,7 @@ void popup_surface_init(struct popup_surface *self) {
     }
 
     /* Create a shared memory pool */
-    struct wl_shm *wl_shm = self->registry->wl_shm;
+    struct wl_shm *wl_shm = registry_get_wl_shm(self->registry);
     if (wl_shm == NULL) {
         complain_about_missing_global("wl_shm");
     }
@@ -142,7 +156,9 @@ void popup_surface_init(struct popup_surface *self) {
     }
 #endif
 #ifdef HAVE_XDG_ACTIVATION
-    if (self->registry->xdg_activation_v1 != NULL) {
+    struct xdg_activation_v1 *xdg_activation_v1
+        = registry_get_xdg_activation_v1(self->registry);
+    if (xdg_activation_v1 != NULL) {
         /* See if someone was kind enough to leave
          * some tokens for us in the environment.
          */
@@ -152,7 +168,7 @@ void popup_surface_init(struct popup_surface *self) {
         }
         if (token != NULL) {
             xdg_activation_v1_activate(
-                self->registry->xdg_activation_v1,
+                xdg_activation_v1,
                 token,
                 self->wl_surface
             );
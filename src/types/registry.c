@@ -23,70 +23,102 @@
 #include "includes/shell-protocols.h"
 #include "includes/selection-protocols.h"
 #include "util/misc.h"
+#include "util/probes.h"
 
 #include <string.h>
 #include <stdlib.h>
 
-#define BIND(interface_name, known_version) \
-if (strcmp(interface, #interface_name) == 0) { \
-    if (version >= (known_version)) { \
-        self->interface_name = wl_registry_bind( \
-            wl_registry, \
-            name, \
+static void *bind_global(
+    struct registry *self,
+    const struct wl_interface *interface,
+    uint32_t min_version,
+    uint32_t max_version
+) {
+    struct global *global;
+    wl_array_for_each(global, &self->globals) {
+        if (strcmp(global->interface, interface->name) != 0) {
+            continue;
+        }
+        if (global->version < min_version) {
+            continue;
+        }
+        uint32_t version = global->version;
+        if (version > max_version) {
+            version = max_version;
+        }
+        return wl_registry_bind(self->proxy, global->name, interface, version);
+    }
+    return NULL;
+}
+
+/* Macros to reduce implementation boilerplate */
+
+#define GETTER(interface_name, min_version, max_version) \
+struct interface_name *registry_get_ ## interface_name( \
+    struct registry *self \
+) { \
+    if (self->interface_name == NULL) { \
+        self->interface_name = bind_global( \
+            self, \
             &interface_name ## _interface, \
-            known_version \
+            min_version, \
+            max_version \
         ); \
     } \
+    return self->interface_name; \
 }
 
-static void wl_registry_global_handler(
-    void *data,
-    struct wl_registry *wl_registry,
-    uint32_t name,
-    const char *interface,
-    uint32_t version
-) {
-    struct registry *self = (struct registry *) data;
-
-    BIND(wl_compositor, 2)
-    BIND(wl_shm, 1)
+GETTER(wl_compositor, 2, 2)
+GETTER(wl_shm, 1, 1)
 
 #ifdef HAVE_XDG_ACTIVATION
-    BIND(xdg_activation_v1, 1)
+GETTER(xdg_activation_v1, 1, 1)
 #endif
 
-    /* Shells */
+/* Shells */
 
-    BIND(wl_shell, 1)
+static GETTER(wl_shell, 1, 1)
 
 #ifdef HAVE_XDG_SHELL
-    BIND(xdg_wm_base, 1)
+static GETTER(xdg_wm_base, 1, 1)
 #endif
 
 #ifdef HAVE_GTK_SHELL
-    BIND(gtk_shell1, 4)
+GETTER(gtk_shell1, 4, 4)
 #endif
 
-    /* Device managers */
+/* Device managers */
 
-    BIND(wl_data_device_manager, 1)
+static GETTER(wl_data_device_manager, 1, 1)
 
 #ifdef HAVE_GTK_PRIMARY_SELECTION
-    BIND(gtk_primary_selection_device_manager, 1)
+static GETTER(gtk_primary_selection_device_manager, 1, 1)
 #endif
 
 #ifdef HAVE_WP_PRIMARY_SELECTION
-    BIND(zwp_primary_selection_device_manager_v1, 1)
+static GETTER(zwp_primary_selection_device_manager_v1, 1, 1)
 #endif
 
 #ifdef HAVE_WLR_DATA_CONTROL
-    BIND(zwlr_data_control_manager_v1, version > 2 ? 2 : version)
+static GETTER(zwlr_data_control_manager_v1, 1, 2)
 #endif
 
 #ifdef HAVE_EXT_DATA_CONTROL
-    BIND(ext_data_control_manager_v1, 1)
+static GETTER(ext_data_control_manager_v1, 1, 1)
 #endif
 
+static void wl_registry_global_handler(
+    void *data,
+    struct wl_registry *wl_registry,
+    uint32_t name,
+    const char *interface,
+    uint32_t version
+) {
+    struct registry *self = (struct registry *) data;
+
+    /* We need the seats right away, but only
+     * record the other globals for later.
+     */
     if (strcmp(interface, "wl_seat") == 0 && version >= 2) {
         struct seat *seat = calloc(1, sizeof(struct seat));
         seat->proxy = wl_registry_bind(
@@ -95,17 +127,67 @@ static void wl_registry_global_handler(
             &wl_seat_interface,
             2
         );
+        seat->registry_name = name;
         seat_init(seat);
         struct seat **ptr = wl_array_add(&self->seats, sizeof(struct seat *));
         *ptr = seat;
+        if (self->new_seat_callback != NULL) {
+            self->new_seat_callback(self, seat);
+        }
+        return;
     }
+
+    struct global *global = wl_array_add(&self->globals, sizeof(struct global));
+    global->name = name;
+    global->interface = strdup(interface);
+    global->version = version;
 }
 
 static void wl_registry_global_remove_handler(
     void *data,
     struct wl_registry *wl_registry,
     uint32_t name
-) {}
+) {
+    struct registry *self = (struct registry *) data;
+
+    struct seat **seat_ptr;
+    wl_array_for_each(seat_ptr, &self->seats) {
+        if ((*seat_ptr)->registry_name != name) {
+            continue;
+        }
+        struct seat *seat = *seat_ptr;
+        /* Move the last seat into its place */
+        struct seat **last = (struct seat **) (
+            (char *) self->seats.data + self->seats.size - sizeof(seat)
+        );
+        *seat_ptr = *last;
+        self->seats.size -= sizeof(seat);
+        /* Whoever isn't prepared for seats going
+         * away might still be using it, so only
+         * hand it over if asked to.
+         */
+        if (self->seat_removed_callback != NULL) {
+            self->seat_removed_callback(self, seat);
+        }
+        return;
+    }
+
+    /* Make sure not to bind it later */
+    struct global *global;
+    wl_array_for_each(global, &self->globals) {
+        if (global->name != name) {
+            continue;
+        }
+        free(global->interface);
+        struct global *last = (struct global *) (
+            (char *) self->globals.data + self->globals.size
+                - sizeof(struct global)
+        );
+        *global = *last;
+        self->globals.size -= sizeof(struct global);
+        return;
+    }
+}
 
 static const struct wl_registry_listener wl_registry_listener = {
     .global = wl_registry_global_handler,
@@ -113,6 +195,8 @@ static const struct wl_registry_listener wl_registry_listener = {
 };
 
 void registry_init(struct registry *self) {
+    wl_array_init(&self->seats);
+    wl_array_init(&self->globals);
     self->proxy = wl_display_get_registry(self->wl_display);
     wl_registry_add_listener(self->proxy, &wl_registry_listener, self);
 }
@@ -120,14 +204,14 @@ void registry_init(struct registry *self) {
 struct shell *registry_find_shell(struct registry *self) {
     struct shell *shell = calloc(1, sizeof(struct shell));
 
-    if (self->wl_shell != NULL) {
+    if (registry_get_wl_shell(self) != NULL) {
         shell->proxy = (struct wl_proxy *) self->wl_shell;
         shell_init_wl_shell(shell);
         return shell;
     }
 
 #ifdef HAVE_XDG_SHELL
-    if (self->xdg_wm_base != NULL) {
+    if (registry_get_xdg_wm_base(self) != NULL) {
         shell->proxy = (struct wl_proxy *) self->xdg_wm_base;
         shell_init_xdg_shell(shell);
         return shell;
@@ -138,8 +222,41 @@ struct shell *registry_find_shell(struct registry *self) {
     return NULL;
 }
 
-#define TRY(type) \
-if (self->type != NULL) { \
+/* WL_CLIPBOARD_BACKEND can be set to force the use of a
+ * specific protocol, for instance to compare their costs.
+ */
+static int backend_allowed(const char *name) {
+    const char *forced = getenv("WL_CLIPBOARD_BACKEND");
+    return forced == NULL || forced[0] == 0 || strcmp(forced, name) == 0;
+}
+
+/* Makes sure a forced backend is one we know about, as
+ * otherwise we'd reject all of them in a confusing way.
+ */
+static void check_forced_backend(void) {
+    static const char *const names[] = {
+        "ext", "wlr", "core", "wp", "gtk", NULL
+    };
+    const char *forced = getenv("WL_CLIPBOARD_BACKEND");
+    if (forced == NULL || forced[0] == 0) {
+        return;
+    }
+    for (const char *const *name = names; *name != NULL; name++) {
+        if (strcmp(forced, *name) == 0) {
+            return;
+        }
+    }
+    fprintf(
+        stderr,
+        "Unknown WL_CLIPBOARD_BACKEND value: %s\n"
+        "Expected one of ext, wlr, core, wp, or gtk\n",
+        forced
+    );
+    exit(1);
+}
+
+#define TRY(type, name) \
+if (backend_allowed(name) && registry_get_ ## type(self) != NULL) { \
     device_manager->proxy = (struct wl_proxy *) self->type; \
     device_manager_init_ ## type(device_manager); \
     return device_manager; \
@@ -149,6 +266,8 @@ struct device_manager *registry_find_device_manager(
     struct registry *self,
     int primary
 ) {
+    check_forced_backend();
+
     struct device_manager *device_manager
         = calloc(1, sizeof(struct device_manager));
     device_manager->wl_display = self->wl_display;
@@ -160,12 +279,12 @@ struct device_manager *registry_find_device_manager(
 
     if (!primary) {
 #ifdef HAVE_EXT_DATA_CONTROL
-        TRY(ext_data_control_manager_v1)
+        TRY(ext_data_control_manager_v1, "ext")
 #endif
 #ifdef HAVE_WLR_DATA_CONTROL
-        TRY(zwlr_data_control_manager_v1)
+        TRY(zwlr_data_control_manager_v1, "wlr")
 #endif
-        TRY(wl_data_device_manager)
+        TRY(wl_data_device_manager, "core")
 
         free(device_manager);
         return NULL;
@@ -186,11 +305,14 @@ struct device_manager *registry_find_device_manager(
      */
 
 #ifdef HAVE_EXT_DATA_CONTROL
-    TRY(ext_data_control_manager_v1)
+    TRY(ext_data_control_manager_v1, "ext")
 #endif
 
 #ifdef HAVE_WLR_DATA_CONTROL
-    if (self->zwlr_data_control_manager_v1 != NULL) {
+    if (
+        backend_allowed("wlr") &&
+        registry_get_zwlr_data_control_manager_v1(self) != NULL
+    ) {
         struct wl_proxy *proxy
             = (struct wl_proxy *) self->zwlr_data_control_manager_v1;
         if (wl_proxy_get_version(proxy) >= 2) {
@@ -202,11 +324,11 @@ struct device_manager *registry_find_device_manager(
 #endif
 
 #ifdef HAVE_WP_PRIMARY_SELECTION
-    TRY(zwp_primary_selection_device_manager_v1)
+    TRY(zwp_primary_selection_device_manager_v1, "wp")
 #endif
 
 #ifdef HAVE_GTK_PRIMARY_SELECTION
-    TRY(gtk_primary_selection_device_manager)
+    TRY(gtk_primary_selection_device_manager, "gtk")
 #endif
 
     free(device_manager);
@@ -217,13 +339,27 @@ struct seat *registry_find_seat(
     struct registry *self,
     const char *name
 ) {
+    /* If any seat will do, there's no need to wait for the
+     * seat info, so just pick the first one. The info will
+     * arrive along with the replies to any further requests.
+     */
+    if (name == NULL) {
+        if (self->seats.size == 0) {
+            return NULL;
+        }
+        struct seat **seats = self->seats.data;
+        return seats[0];
+    }
+
     /* Ensure we get all the seat info */
+    PROBE(roundtrip_begin);
     wl_display_roundtrip(self->wl_display);
+    PROBE(roundtrip_end);
 
     struct seat **ptr;
     wl_array_for_each(ptr, &self->seats) {
         struct seat *seat = *ptr;
-        if (name == NULL || strcmp(seat->name, name) == 0) {
+        if (seat->name != NULL && strcmp(seat->name, name) == 0) {
             return seat;
         }
     }
@@ -29,13 +29,26 @@ struct device_manager;
 struct seat;
 
 struct registry {
-    /* This field is initialized by the creator */
+    /* These fields are initialized by the creator */
     struct wl_display *wl_display;
+    /* If set, called whenever a new seat appears */
+    void (*new_seat_callback)(struct registry *self, struct seat *seat);
+    /* If set, called when a seat goes away, after it has been
+     * removed from seats. The callback takes ownership of the
+     * seat, and should seat_destroy() it once done with it.
+     */
+    void (*seat_removed_callback)(struct registry *self, struct seat *seat);
 
     /* These fields are initialized by the implementation */
 
     struct wl_registry *proxy;
     struct wl_array seats;
+    /* All the advertised globals, as struct global */
+    struct wl_array globals;
+
+    /* The rest of the globals only get bound on demand,
+     * through the registry_get_*() functions below.
+     */
 
     struct wl_compositor *wl_compositor;
     struct wl_shm *wl_shm;
@@ -75,8 +88,29 @@ struct registry {
 #endif
 };
 
+struct global {
+    uint32_t name;
+    char *interface;
+    uint32_t version;
+};
+
 void registry_init(struct registry *self);
 
+/* These return NULL if the global is not available */
+
+struct wl_compositor *registry_get_wl_compositor(struct registry *self);
+struct wl_shm *registry_get_wl_shm(struct registry *self);
+
+#ifdef HAVE_XDG_ACTIVATION
+struct xdg_activation_v1 *registry_get_xdg_activation_v1(
+    struct registry *self
+);
+#endif
+
+#ifdef HAVE_GTK_SHELL
+struct gtk_shell1 *registry_get_gtk_shell1(struct registry *self);
+#endif
+
 struct shell *registry_find_shell(struct registry *self);
 
 struct device_manager *registry_find_device_manager(
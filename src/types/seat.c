@@ -30,6 +30,7 @@ static void wl_seat_capabilities_handler(
 ) {
     struct seat *self = (struct seat *) data;
     self->capabilities = capabilities;
+    self->has_capabilities = 1;
 }
 
 static void wl_seat_name_handler(
@@ -59,3 +60,9 @@ struct keyboard *seat_get_keyboard(struct seat *self) {
     keyboard_init(keyboard);
     return keyboard;
 }
+
+void seat_destroy(struct seat *self) {
+    wl_seat_destroy(self->proxy);
+    free(self->name);
+    free(self);
+}
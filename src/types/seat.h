@@ -24,16 +24,21 @@
 struct keyboard;
 
 struct seat {
-    /* This field is initialized by the creator */
+    /* These fields are initialized by the creator */
     struct wl_seat *proxy;
+    /* The name of the wl_seat global */
+    uint32_t registry_name;
 
     /* These fields are initialized by the implementation */
     char *name;
     uint32_t capabilities;
+    /* Whether we have received the capabilities yet */
+    int has_capabilities;
 };
 
 void seat_init(struct seat *self);
 struct keyboard *seat_get_keyboard(struct seat *self);
+void seat_destroy(struct seat *self);
 
 
 #endif /* TYPES_SEAT_H */
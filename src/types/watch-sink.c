@@ -0,0 +1,341 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types/watch-sink.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* Writes the data, keeping track of how
+ * much of it we've written in self->written.
+ */
+static int write_all(
+    struct watch_sink *self,
+    const char *data,
+    size_t length
+) {
+    while (length > 0) {
+        ssize_t rc = write(self->fd, data, length);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc < 0) {
+            return 0;
+        }
+        data += rc;
+        length -= rc;
+        self->written += rc;
+    }
+    return 1;
+}
+
+/* Same, for the rest of the data in data_fd */
+static int copy_data(struct watch_sink *self, int data_fd) {
+    char buffer[64 * 1024];
+    while (1) {
+        ssize_t len = read(data_fd, buffer, sizeof(buffer));
+        if (len < 0 && errno == EINTR) {
+            continue;
+        } else if (len < 0) {
+            return 0;
+        } else if (len == 0) {
+            return 1;
+        }
+        if (!write_all(self, buffer, len)) {
+            return 0;
+        }
+    }
+}
+
+static void close_sink(struct watch_sink *self) {
+    close(self->fd);
+    self->fd = -1;
+    if (self->pid > 0) {
+        /* Don't wait for it to exit, just collect it if it has */
+        waitpid(self->pid, NULL, WNOHANG);
+        self->pid = 0;
+    }
+}
+
+int watch_sink_write(
+    struct watch_sink *self,
+    int data_fd,
+    size_t size,
+    const char *mime_type,
+    const char *clipboard_state,
+    const char *seat_name
+) {
+    /* If writing fails, the other side might have gone away,
+     * so reopen the sink and try again, but only once.
+     */
+    self->written = 0;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (self->fd < 0 && !self->do_open(self)) {
+            return 0;
+        }
+        if (data_fd >= 0 && lseek(data_fd, 0, SEEK_SET) < 0) {
+            perror("lseek");
+            return 0;
+        }
+        int rc = self->do_write(
+            self,
+            data_fd,
+            size,
+            mime_type,
+            clipboard_state,
+            seat_name
+        );
+        if (rc) {
+            return 1;
+        }
+        close_sink(self);
+    }
+    fprintf(stderr, "Failed to write to %s\n", self->path);
+    return 0;
+}
+
+/* Returns an owned copy of the header field with spaces, control
+ * characters and percent signs escaped as %XX, so that the fields
+ * can be split on spaces. Missing values are represented by -.
+ */
+static char *escape_field(const char *value) {
+    if (value == NULL) {
+        return strdup("-");
+    }
+    char *escaped = malloc(strlen(value) * 3 + 4);
+    char *out = escaped;
+    for (const char *in = value; *in != 0; in++) {
+        unsigned char c = *in;
+        if (c <= 0x20 || c == 0x7f || c == '%') {
+            out += sprintf(out, "%%%02x", c);
+        } else {
+            *out++ = c;
+        }
+    }
+    *out = 0;
+    /* Make sure an actual - is not mistaken for a missing value */
+    if (strcmp(escaped, "-") == 0) {
+        strcpy(escaped, "%2d");
+    }
+    return escaped;
+}
+
+/* Bump this whenever the header fields change, so
+ * that readers can tell which format they're getting.
+ * Version 1 had no version field and no seat name.
+ */
+#define FRAME_VERSION 2
+
+/* Frames consist of a header line with the format version, the
+ * MIME type, the clipboard state, the size and the seat name,
+ * separated by spaces, followed by the data.
+ */
+static int write_frame(
+    struct watch_sink *self,
+    int data_fd,
+    size_t size,
+    const char *mime_type,
+    const char *clipboard_state,
+    const char *seat_name
+) {
+    /* Whoever is reading now needs the whole frame */
+    self->written = 0;
+
+    char *escaped_mime_type = escape_field(mime_type);
+    char *escaped_seat_name = escape_field(seat_name);
+    size_t length = strlen(escaped_mime_type) + strlen(clipboard_state)
+        + strlen(escaped_seat_name) + 32;
+    char *header = malloc(length);
+    snprintf(
+        header,
+        length,
+        "v%d %s %s %zu %s\n",
+        FRAME_VERSION,
+        escaped_mime_type,
+        clipboard_state,
+        size,
+        escaped_seat_name
+    );
+    free(escaped_mime_type);
+    free(escaped_seat_name);
+    int rc = write_all(self, header, strlen(header));
+    free(header);
+    if (!rc) {
+        return 0;
+    }
+    if (data_fd >= 0) {
+        return copy_data(self, data_fd);
+    }
+    return 1;
+}
+
+
+/* Appending to a file */
+
+static int append_do_open(struct watch_sink *self) {
+    int flags = O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC;
+    self->fd = open(self->path, flags, 0666);
+    if (self->fd < 0) {
+        perror(self->path);
+        return 0;
+    }
+    return 1;
+}
+
+static int append_do_write(
+    struct watch_sink *self,
+    int data_fd,
+    size_t size,
+    const char *mime_type,
+    const char *clipboard_state,
+    const char *seat_name
+) {
+    /* Nothing to append if the selection has been cleared */
+    if (data_fd < 0) {
+        return 1;
+    }
+    /* If we're retrying, the file still has what we've
+     * written before, so pick up where we left off.
+     */
+    size_t skip = self->written;
+    if (skip < size) {
+        if (lseek(data_fd, skip, SEEK_SET) < 0) {
+            return 0;
+        }
+        if (!copy_data(self, data_fd)) {
+            return 0;
+        }
+        skip = 0;
+    } else {
+        skip -= size;
+    }
+    return write_all(
+        self,
+        self->separator + skip,
+        self->separator_length - skip
+    );
+}
+
+void watch_sink_init_append(struct watch_sink *self) {
+    self->fd = -1;
+    self->do_open = append_do_open;
+    self->do_write = append_do_write;
+}
+
+
+/* Unix sockets and FIFOs */
+
+static int socket_do_open(struct watch_sink *self) {
+    struct stat st;
+    if (stat(self->path, &st) == 0 && S_ISFIFO(st.st_mode)) {
+        /* A blocking open would wait for a reader to appear,
+         * stalling the whole event loop in the meantime.
+         */
+        self->fd = open(self->path, O_WRONLY | O_CLOEXEC | O_NONBLOCK);
+        if (self->fd < 0 && errno == ENXIO) {
+            /* Nobody is reading, so drop the frame */
+            return 0;
+        }
+        if (self->fd < 0) {
+            perror(self->path);
+            return 0;
+        }
+        /* But once there is one, do wait for it to keep up */
+        fcntl(self->fd, F_SETFL, 0);
+        return 1;
+    }
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(self->path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path is too long: %s\n", self->path);
+        return 0;
+    }
+    strcpy(addr.sun_path, self->path);
+    self->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (self->fd < 0) {
+        perror("socket");
+        return 0;
+    }
+    fcntl(self->fd, F_SETFD, FD_CLOEXEC);
+    if (connect(self->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        perror(self->path);
+        close(self->fd);
+        self->fd = -1;
+        return 0;
+    }
+    return 1;
+}
+
+void watch_sink_init_socket(struct watch_sink *self) {
+    self->fd = -1;
+    self->do_open = socket_do_open;
+    self->do_write = write_frame;
+}
+
+
+/* Coprocesses */
+
+static int coprocess_do_open(struct watch_sink *self) {
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        perror("pipe");
+        return 0;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return 0;
+    }
+    if (pid == 0) {
+        dup2(pipefd[0], STDIN_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        signal(SIGPIPE, SIG_DFL);
+        execvp(self->argv[0], self->argv);
+        fprintf(
+            stderr,
+            "Failed to spawn %s: %s\n",
+            self->argv[0],
+            strerror(errno)
+        );
+        _exit(1);
+    }
+    close(pipefd[0]);
+    fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+    self->fd = pipefd[1];
+    self->pid = pid;
+    return 1;
+}
+
+void watch_sink_init_coprocess(struct watch_sink *self) {
+    self->fd = -1;
+    self->path = self->argv[0];
+    self->do_open = coprocess_do_open;
+    self->do_write = write_frame;
+}
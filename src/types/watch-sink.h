@@ -0,0 +1,79 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TYPES_WATCH_SINK_H
+#define TYPES_WATCH_SINK_H
+
+#include "util/string.h"
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* A built-in destination for the clipboard contents
+ * in watch mode, as opposed to spawning a command
+ * for each selection change.
+ */
+struct watch_sink {
+    /* These fields are initialized by the creator */
+    const char *path;
+    argv_t argv;
+    const char *separator;
+    size_t separator_length;
+
+    /* These fields are initialized by the implementation */
+    int fd;
+    pid_t pid;
+    /* How much of the current write has made it through */
+    size_t written;
+    int (*do_open)(struct watch_sink *self);
+    int (*do_write)(
+        struct watch_sink *self,
+        int data_fd,
+        size_t size,
+        const char *mime_type,
+        const char *clipboard_state,
+        const char *seat_name
+    );
+};
+
+/* Writes size bytes read from data_fd, which may be -1 if
+ * the selection has been cleared. The seat name may be NULL
+ * if unknown. The sink gets (re)opened as needed. Returns
+ * whether the write has succeeded.
+ */
+int watch_sink_write(
+    struct watch_sink *self,
+    int data_fd,
+    size_t size,
+    const char *mime_type,
+    const char *clipboard_state,
+    const char *seat_name
+);
+
+/* Initializers */
+
+/* Appends the data to the file at path, followed by the separator */
+void watch_sink_init_append(struct watch_sink *self);
+
+/* Writes frames to a unix socket or a FIFO at path */
+void watch_sink_init_socket(struct watch_sink *self);
+
+/* Writes frames to the stdin of a long-running process */
+void watch_sink_init_coprocess(struct watch_sink *self);
+
+#endif /* TYPES_WATCH_SINK_H */
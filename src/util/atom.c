@@ -0,0 +1,231 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/atom.h"
+#include "util/string.h"
+#include "util/hash.h"
+
+#include <wayland-util.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+struct atom_info {
+    /* NULL for freed dynamic atoms, and ATOM_NONE */
+    const char *name;
+    int is_text;
+    int is_image;
+    const char *charset;
+    /* Only counted for dynamic atoms */
+    unsigned refcount;
+};
+
+/* Attributes of the well-known atoms, indexed by atom */
+static const struct atom_info well_known_atoms[ATOM_FIRST_DYNAMIC] = {
+    [ATOM_NONE] = { NULL, 0, 0, NULL },
+    [ATOM_TEXT_PLAIN] = { text_plain, 1, 0, NULL },
+    [ATOM_TEXT_PLAIN_UTF8] = { text_plain_utf8, 1, 0, "utf-8" },
+    [ATOM_TEXT] = { "TEXT", 1, 0, NULL },
+    [ATOM_STRING] = { "STRING", 1, 0, NULL },
+    [ATOM_UTF8_STRING] = { "UTF8_STRING", 1, 0, "utf-8" },
+    [ATOM_X_KDE_PASSWORD_MANAGER_HINT] = {
+        x_kde_password_manager_hint, 0, 0, NULL
+    },
+    [ATOM_APPLICATION_OCTET_STREAM] = {
+        application_octet_stream, 0, 0, NULL
+    },
+    [ATOM_TEXT_HTML] = { "text/html", 1, 0, NULL },
+    [ATOM_TEXT_URI_LIST] = { "text/uri-list", 1, 0, NULL },
+    [ATOM_IMAGE_PNG] = { "image/png", 0, 1, NULL },
+    [ATOM_IMAGE_JPEG] = { "image/jpeg", 0, 1, NULL },
+};
+
+/* All known atoms, indexed by atom */
+static struct wl_array atoms;
+/* An open-addressing hash table of atoms, keyed by
+ * their names. Zero (ATOM_NONE) marks empty slots.
+ */
+static atom_t *buckets = NULL;
+static size_t bucket_count = 0;
+/* Freed dynamic atoms, to be reused */
+static struct wl_array free_atoms;
+
+static size_t atom_count(void) {
+    return atoms.size / sizeof(struct atom_info);
+}
+
+static struct atom_info *get_info(atom_t atom) {
+    struct atom_info *infos = atoms.data;
+    return &infos[atom];
+}
+
+static void insert_into_buckets(atom_t atom) {
+    size_t mask = bucket_count - 1;
+    size_t index = hash_string(get_info(atom)->name) & mask;
+    while (buckets[index] != ATOM_NONE) {
+        index = (index + 1) & mask;
+    }
+    buckets[index] = atom;
+}
+
+static void rehash(size_t new_bucket_count) {
+    free(buckets);
+    bucket_count = new_bucket_count;
+    buckets = calloc(bucket_count, sizeof(atom_t));
+    for (atom_t atom = ATOM_NONE + 1; atom < atom_count(); atom++) {
+        if (get_info(atom)->name != NULL) {
+            insert_into_buckets(atom);
+        }
+    }
+}
+
+static void remove_from_buckets(atom_t atom) {
+    size_t mask = bucket_count - 1;
+    size_t index = hash_string(get_info(atom)->name) & mask;
+    while (buckets[index] != atom) {
+        index = (index + 1) & mask;
+    }
+    buckets[index] = ATOM_NONE;
+    /* Reinsert the rest of the cluster, so that
+     * lookups don't stop short at the new hole.
+     */
+    for (
+        index = (index + 1) & mask;
+        buckets[index] != ATOM_NONE;
+        index = (index + 1) & mask
+    ) {
+        atom_t other = buckets[index];
+        buckets[index] = ATOM_NONE;
+        insert_into_buckets(other);
+    }
+}
+
+static void ensure_initialized(void) {
+    if (buckets != NULL) {
+        return;
+    }
+    wl_array_init(&atoms);
+    wl_array_init(&free_atoms);
+    void *ptr = wl_array_add(&atoms, sizeof(well_known_atoms));
+    memcpy(ptr, well_known_atoms, sizeof(well_known_atoms));
+    rehash(64);
+}
+
+static char *parse_charset(const char *name) {
+    const char *param = strchr(name, ';');
+    while (param != NULL) {
+        param++;
+        while (*param == ' ') {
+            param++;
+        }
+        if (strncasecmp(param, "charset=", strlen("charset=")) == 0) {
+            const char *value = param + strlen("charset=");
+            size_t len = strcspn(value, "; ");
+            char *charset = strndup(value, len);
+            for (char *c = charset; *c != 0; c++) {
+                *c = tolower((unsigned char) *c);
+            }
+            return charset;
+        }
+        param = strchr(param, ';');
+    }
+    return NULL;
+}
+
+atom_t atom_lookup(const char *name) {
+    ensure_initialized();
+    size_t mask = bucket_count - 1;
+    size_t index = hash_string(name) & mask;
+    for (; buckets[index] != ATOM_NONE; index = (index + 1) & mask) {
+        atom_t atom = buckets[index];
+        if (strcmp(get_info(atom)->name, name) == 0) {
+            return atom;
+        }
+    }
+    return ATOM_NONE;
+}
+
+atom_t atom_intern(const char *name) {
+    atom_t atom = atom_lookup(name);
+    if (atom != ATOM_NONE) {
+        get_info(atom)->refcount++;
+        return atom;
+    }
+
+    /* Reuse a freed atom if there is one */
+    if (free_atoms.size > 0) {
+        free_atoms.size -= sizeof(atom_t);
+        atom = *(atom_t *) ((char *) free_atoms.data + free_atoms.size);
+    } else {
+        wl_array_add(&atoms, sizeof(struct atom_info));
+        atom = atom_count() - 1;
+    }
+
+    /* Compute the attributes of a new atom */
+    struct atom_info *info = get_info(atom);
+    info->name = strdup(name);
+    info->is_text = mime_type_is_text(name);
+    info->is_image = str_has_prefix(name, "image/");
+    info->charset = parse_charset(name);
+    info->refcount = 1;
+
+    /* Keep the load factor below one half */
+    if (atom_count() * 2 > bucket_count) {
+        rehash(bucket_count * 2);
+    } else {
+        insert_into_buckets(atom);
+    }
+    return atom;
+}
+
+void atom_release(atom_t atom) {
+    if (atom < ATOM_FIRST_DYNAMIC) {
+        return;
+    }
+    struct atom_info *info = get_info(atom);
+    if (--info->refcount > 0) {
+        return;
+    }
+    remove_from_buckets(atom);
+    free((char *) info->name);
+    free((char *) info->charset);
+    memset(info, 0, sizeof(*info));
+    atom_t *ptr = wl_array_add(&free_atoms, sizeof(atom_t));
+    *ptr = atom;
+}
+
+const char *atom_name(atom_t atom) {
+    ensure_initialized();
+    return get_info(atom)->name;
+}
+
+int atom_is_text(atom_t atom) {
+    ensure_initialized();
+    return get_info(atom)->is_text;
+}
+
+int atom_is_image(atom_t atom) {
+    ensure_initialized();
+    return get_info(atom)->is_image;
+}
+
+const char *atom_charset(atom_t atom) {
+    ensure_initialized();
+    return get_info(atom)->charset;
+}
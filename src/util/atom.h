@@ -0,0 +1,67 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTIL_ATOM_H
+#define UTIL_ATOM_H
+
+#include <stdint.h>
+
+/* Atoms are small integers that stand for interned MIME
+ * type strings. Interning the same string twice yields
+ * the same atom, so atoms can be compared directly, and
+ * their attributes only get computed once.
+ */
+typedef uint32_t atom_t;
+
+/* Well-known atoms */
+enum {
+    ATOM_NONE = 0,
+    ATOM_TEXT_PLAIN,
+    ATOM_TEXT_PLAIN_UTF8,
+    ATOM_TEXT,
+    ATOM_STRING,
+    ATOM_UTF8_STRING,
+    ATOM_X_KDE_PASSWORD_MANAGER_HINT,
+    ATOM_APPLICATION_OCTET_STREAM,
+    ATOM_TEXT_HTML,
+    ATOM_TEXT_URI_LIST,
+    ATOM_IMAGE_PNG,
+    ATOM_IMAGE_JPEG,
+
+    ATOM_FIRST_DYNAMIC
+};
+
+/* Interning a string that is not well-known takes a reference
+ * to its atom, which has to be dropped with atom_release() once
+ * the atom is no longer needed. Once all the references are
+ * gone, the atom gets freed, and may later stand for another
+ * string, so that long-running processes which see arbitrary
+ * types over time don't keep growing.
+ */
+atom_t atom_intern(const char *name);
+void atom_release(atom_t atom);
+/* Unlike atom_intern(), returns ATOM_NONE for unknown strings */
+atom_t atom_lookup(const char *name);
+
+const char *atom_name(atom_t atom);
+int atom_is_text(atom_t atom);
+int atom_is_image(atom_t atom);
+/* Returns the lowercase charset parameter, or NULL if there is none */
+const char *atom_charset(atom_t atom);
+
+#endif /* UTIL_ATOM_H */
@@ -19,6 +19,7 @@
 #include "util/files.h"
 #include "util/string.h"
 #include "util/misc.h"
+#include "util/text.h"
 
 #include "config.h"
 
@@ -39,6 +40,18 @@
 
 #ifdef HAVE_MEMFD
 #    include <sys/syscall.h> // syscall, SYS_memfd_create
+/* Without _GNU_SOURCE, the libc headers don't expose these */
+#    ifndef MFD_CLOEXEC
+#        define MFD_CLOEXEC 0x0001U
+#        define MFD_ALLOW_SEALING 0x0002U
+#    endif
+#    ifndef F_ADD_SEALS
+#        define F_ADD_SEALS 1033
+#        define F_SEAL_SEAL 0x0001
+#        define F_SEAL_SHRINK 0x0002
+#        define F_SEAL_GROW 0x0004
+#        define F_SEAL_WRITE 0x0008
+#    endif
 #endif
 #ifdef HAVE_SHM_ANON
 #    include <sys/mman.h> // shm_open, SHM_ANON
@@ -84,7 +97,7 @@ void complain_about_closed_stdio(struct wl_display *wl_display) {
 int create_anonymous_file() {
     int res;
 #ifdef HAVE_MEMFD
-    res = syscall(SYS_memfd_create, "buffer", 0);
+    res = syscall(SYS_memfd_create, "buffer", MFD_CLOEXEC);
     if (res >= 0) {
         return res;
     }
@@ -95,8 +108,72 @@ int create_anonymous_file() {
         return res;
     }
 #endif
-    (void) res;
-    return fileno(tmpfile());
+    res = fileno(tmpfile());
+    if (res >= 0) {
+        fcntl(res, F_SETFD, FD_CLOEXEC);
+    }
+    return res;
+}
+
+int create_sealable_file() {
+#ifdef HAVE_MEMFD
+    int res = syscall(
+        SYS_memfd_create,
+        "buffer",
+        MFD_CLOEXEC | MFD_ALLOW_SEALING
+    );
+    if (res >= 0) {
+        return res;
+    }
+#endif
+    return create_anonymous_file();
+}
+
+int seal_file(int fd) {
+#ifdef HAVE_MEMFD
+    int seals = F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+    return fcntl(fd, F_ADD_SEALS, seals) == 0;
+#else
+    (void) fd;
+    return 0;
+#endif
+}
+
+int write_fully(int fd, const char *data, size_t length) {
+    size_t offset = 0;
+    while (offset < length) {
+        ssize_t nwritten = write(fd, data + offset, length - offset);
+        if (nwritten < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nwritten < 0) {
+            return 0;
+        }
+        offset += nwritten;
+    }
+    return 1;
+}
+
+int copy_fd_contents(int from_fd, int to_fd, size_t *copied) {
+    char buffer[64 * 1024];
+    while (1) {
+        ssize_t nread = read(from_fd, buffer, sizeof(buffer));
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nread < 0) {
+            return 0;
+        }
+        if (nread == 0) {
+            return 1;
+        }
+        if (!write_fully(to_fd, buffer, nread)) {
+            return 0;
+        }
+        if (copied != NULL) {
+            *copied += nread;
+        }
+    }
 }
 
 void trim_trailing_newline(const char *file_path) {
@@ -135,6 +212,38 @@ out:
     close(fd);
 }
 
+int file_looks_like_text(const char *file_path) {
+    int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror("open file for scanning");
+        /* Assume text, as we did before we had this check */
+        return 1;
+    }
+
+    struct text_scanner scanner;
+    text_scanner_init(&scanner);
+
+    char buffer[64 * 1024];
+    while (1) {
+        ssize_t len = read(fd, buffer, sizeof(buffer));
+        if (len < 0 && errno == EINTR) {
+            continue;
+        } else if (len < 0) {
+            perror("read");
+            break;
+        } else if (len == 0) {
+            break;
+        }
+        /* Stop as soon as we see something non-textual */
+        if (!text_scanner_feed(&scanner, buffer, len)) {
+            break;
+        }
+    }
+
+    close(fd);
+    return text_scanner_finish(&scanner);
+}
+
 char *path_for_fd(int fd) {
     char fdpath[64];
     snprintf(fdpath, sizeof(fdpath), "/dev/fd/%d", fd);
@@ -172,7 +281,7 @@ char *infer_mime_type_from_contents(const char *file_path) {
         signal(SIGHUP, SIG_DFL);
         signal(SIGPIPE, SIG_DFL);
         execlp("xdg-mime", "xdg-mime", "query", "filetype", file_path, NULL);
-        exit(1);
+        _exit(1);
     }
 
     close(pipefd[1]);
@@ -293,7 +402,7 @@ char *infer_mime_type_from_name(const char *file_path) {
 }
 
 /* Returns the name of a new file */
-char *dump_stdin_into_a_temp_file() {
+pid_t start_dumping_stdin_into_a_temp_file(char **file_path) {
     /* Pick a name for the file we'll be
      * creating inside that directory. We
      * try to preserve the original name for
@@ -336,7 +445,7 @@ char *dump_stdin_into_a_temp_file() {
         int fd = creat(path, S_IRUSR | S_IWUSR);
         if (fd < 0) {
             perror("creat");
-            exit(1);
+            _exit(1);
         }
         dup2(fd, STDOUT_FILENO);
         close(fd);
@@ -344,14 +453,18 @@ char *dump_stdin_into_a_temp_file() {
         signal(SIGPIPE, SIG_DFL);
         execlp("cat", "cat", NULL);
         perror("exec cat");
-        exit(1);
+        _exit(1);
     }
 
+    free(original_path);
+    *file_path = path;
+    return pid;
+}
+
+void finish_dumping_stdin_into_a_temp_file(pid_t pid) {
     int wstatus;
     waitpid(pid, &wstatus, 0);
-    free(original_path);
     if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
         bail("Failed to copy the file");
     }
-    return path;
 }
@@ -19,13 +19,39 @@
 #ifndef UTIL_FILES_H
 #define UTIL_FILES_H
 
+#include <sys/types.h> // pid_t
+
 struct wl_display;
 void complain_about_closed_stdio(struct wl_display *wl_display);
 
+/* The file is close-on-exec, so pass it to
+ * spawned processes with dup2().
+ */
 int create_anonymous_file(void);
 
+/* Like create_anonymous_file(), but creates a memfd if
+ * possible, which seal_file() can then make immutable.
+ * seal_file() returns whether it has succeeded.
+ */
+int create_sealable_file(void);
+int seal_file(int fd);
+
 void trim_trailing_newline(const char *file_path);
 
+/* Writes all of the data, retrying on short writes.
+ * Returns whether the writing has succeeded.
+ */
+int write_fully(int fd, const char *data, size_t length);
+
+/* Reads from_fd until EOF, writing the data to to_fd. Adds
+ * the number of bytes written to *copied, unless it's NULL.
+ * Returns whether the copying has succeeded.
+ */
+int copy_fd_contents(int from_fd, int to_fd, size_t *copied);
+
+/* Whether the file contents look like UTF-8 text */
+int file_looks_like_text(const char *file_path);
+
 /* These functions return owned strings, so make sure
  * to free() their return values when done with them.
  */
@@ -34,7 +60,13 @@ char *path_for_fd(int fd);
 char *infer_mime_type_from_contents(const char *file_path);
 char *infer_mime_type_from_name(const char *file_path);
 
-/* Returns the name of a new file */
-char *dump_stdin_into_a_temp_file(void);
+/* Starts copying our stdin into a new temp file in
+ * the background, and stores the name of the file
+ * into *file_path. Returns the pid of the process
+ * doing the copying, which must then be passed to
+ * finish_dumping_stdin_into_a_temp_file().
+ */
+pid_t start_dumping_stdin_into_a_temp_file(char **file_path);
+void finish_dumping_stdin_into_a_temp_file(pid_t pid);
 
 #endif /* UTIL_FILES_H */
@@ -0,0 +1,36 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/hash.h"
+
+#include <string.h>
+
+#define FNV_PRIME ((uint64_t) 0x100000001b3ull)
+
+uint64_t hash_update(uint64_t hash, const void *data, size_t length) {
+    const unsigned char *ptr = data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= ptr[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t hash_string(const char *string) {
+    return hash_update(HASH_INIT, string, strlen(string));
+}
@@ -0,0 +1,34 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTIL_HASH_H
+#define UTIL_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A simple non-cryptographic 64-bit hash (FNV-1a).
+ * Start with HASH_INIT and feed data in any number
+ * of chunks; the result only depends on the bytes.
+ */
+#define HASH_INIT ((uint64_t) 0xcbf29ce484222325ull)
+
+uint64_t hash_update(uint64_t hash, const void *data, size_t length);
+uint64_t hash_string(const char *string);
+
+#endif /* UTIL_HASH_H */
@@ -0,0 +1,90 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "util/json.h"
+#include "util/text.h"
+
+/* How long the UTF-8 sequence starting with
+ * this byte should be, or 0 if it can't start one.
+ */
+static size_t sequence_length(unsigned char c) {
+    if (c >= 0xc2 && c <= 0xdf) {
+        return 2;
+    } else if (c >= 0xe0 && c <= 0xef) {
+        return 3;
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        return 4;
+    }
+    return 0;
+}
+
+/* Prints the multi-byte sequence at the start of the data if it is
+ * valid, or a replacement character otherwise. Returns how many
+ * bytes it has consumed.
+ */
+static size_t print_sequence(FILE *f, const char *data, size_t length) {
+    size_t sequence = sequence_length((unsigned char) data[0]);
+    if (sequence != 0 && sequence <= length) {
+        struct text_scanner scanner;
+        text_scanner_init(&scanner);
+        text_scanner_feed(&scanner, data, sequence);
+        if (text_scanner_finish(&scanner)) {
+            fwrite(data, 1, sequence, f);
+            return sequence;
+        }
+    }
+    fputs("\\ufffd", f);
+    return 1;
+}
+
+void json_print_string(FILE *f, const char *data, size_t length) {
+    fputc('"', f);
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = data[i];
+        if (c >= 0x80) {
+            i += print_sequence(f, data + i, length - i) - 1;
+            continue;
+        }
+        switch (c) {
+        case '"':
+            fputs("\\\"", f);
+            break;
+        case '\\':
+            fputs("\\\\", f);
+            break;
+        case '\n':
+            fputs("\\n", f);
+            break;
+        case '\r':
+            fputs("\\r", f);
+            break;
+        case '\t':
+            fputs("\\t", f);
+            break;
+        default:
+            if (c < 0x20 || c == 0x7f) {
+                fprintf(f, "\\u%04x", c);
+            } else {
+                fputc(c, f);
+            }
+            break;
+        }
+    }
+    fputc('"', f);
+}
@@ -0,0 +1,32 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef UTIL_JSON_H
+#define UTIL_JSON_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Prints the data as a quoted JSON string, escaping
+ * quotes, backslashes and control characters, and
+ * replacing invalid UTF-8 sequences with U+FFFD.
+ */
+void json_print_string(FILE *f, const char *data, size_t length);
+
+#endif /* UTIL_JSON_H */
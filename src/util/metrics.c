@@ -0,0 +1,206 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/metrics.h"
+
+#include <wayland-util.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/resource.h>
+
+/* Latency buckets are powers of two milliseconds,
+ * from under 1 ms up to 1024 ms and over.
+ */
+#define LATENCY_BUCKET_COUNT 12
+
+struct type_counter {
+    char *mime_type;
+    unsigned long count;
+};
+
+static struct {
+    unsigned long transfers;
+    unsigned long long bytes;
+    unsigned long latency_buckets[LATENCY_BUCKET_COUNT];
+    struct wl_array types;
+} metrics;
+
+/* Where we have dumped the metrics, if anywhere. This is
+ * looked at from signal handlers, so set pid before path.
+ */
+static struct {
+    char *volatile path;
+    volatile pid_t pid;
+} dump;
+
+static void count_type(const char *mime_type) {
+    struct type_counter *counter;
+    wl_array_for_each(counter, &metrics.types) {
+        if (strcmp(counter->mime_type, mime_type) == 0) {
+            counter->count++;
+            return;
+        }
+    }
+    counter = wl_array_add(&metrics.types, sizeof(struct type_counter));
+    if (counter == NULL) {
+        return;
+    }
+    counter->mime_type = strdup(mime_type);
+    counter->count = 1;
+}
+
+void metrics_transfer_finished(
+    const char *mime_type,
+    size_t bytes,
+    double duration_ms
+) {
+    metrics.transfers++;
+    metrics.bytes += bytes;
+    count_type(mime_type);
+
+    int bucket = 0;
+    double bound = 1;
+    while (bucket < LATENCY_BUCKET_COUNT - 1 && duration_ms >= bound) {
+        bucket++;
+        bound *= 2;
+    }
+    metrics.latency_buckets[bucket]++;
+}
+
+static void write_metrics(FILE *f) {
+    fprintf(f, "pid %ld\n", (long) getpid());
+    fprintf(f, "transfers %lu\n", metrics.transfers);
+    fprintf(f, "bytes_served %llu\n", metrics.bytes);
+
+    struct type_counter *counter;
+    wl_array_for_each(counter, &metrics.types) {
+        fprintf(
+            f,
+            "transfers_by_type %s %lu\n",
+            counter->mime_type,
+            counter->count
+        );
+    }
+
+    unsigned long bound = 1;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT - 1; i++) {
+        fprintf(
+            f,
+            "latency_ms_below %lu %lu\n",
+            bound,
+            metrics.latency_buckets[i]
+        );
+        bound *= 2;
+    }
+    fprintf(
+        f,
+        "latency_ms_above %lu %lu\n",
+        bound / 2,
+        metrics.latency_buckets[LATENCY_BUCKET_COUNT - 1]
+    );
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        fprintf(f, "max_rss_kb %ld\n", (long) usage.ru_maxrss);
+    }
+}
+
+void metrics_dump() {
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir == NULL || runtime_dir[0] != '/') {
+        fprintf(stderr, "XDG_RUNTIME_DIR is not set, not dumping metrics\n");
+        return;
+    }
+
+    /* Write to a temp file and rename it into place,
+     * so that readers never see a partial dump.
+     */
+    long pid = (long) getpid();
+    size_t len = strlen(runtime_dir) + 64;
+    char *path = malloc(len);
+    char *temp_path = malloc(len);
+    snprintf(path, len, "%s/wl-copy-metrics-%ld", runtime_dir, pid);
+    snprintf(temp_path, len, "%s.XXXXXX", path);
+
+    int fd = mkstemp(temp_path);
+    if (fd < 0) {
+        perror("mkstemp");
+        goto out;
+    }
+    FILE *f = fdopen(fd, "w");
+    if (f == NULL) {
+        perror("fdopen");
+        close(fd);
+        unlink(temp_path);
+        goto out;
+    }
+    write_metrics(f);
+    if (fclose(f) != 0 || rename(temp_path, path) < 0) {
+        perror("Failed to write metrics");
+        unlink(temp_path);
+        goto out;
+    }
+    if (dump.path == NULL) {
+        dump.pid = getpid();
+        dump.path = path;
+        path = NULL;
+    }
+
+out:
+    free(path);
+    free(temp_path);
+}
+
+void metrics_clean_up() {
+    /* Forked children inherit our atexit() handlers.
+     * This only uses async-signal-safe functions.
+     */
+    if (dump.path == NULL || dump.pid != getpid()) {
+        return;
+    }
+    unlink(dump.path);
+}
+
+static void terminating_signal_handler(int signum) {
+    metrics_clean_up();
+    /* Now die of the signal as we would have */
+    signal(signum, SIG_DFL);
+    raise(signum);
+}
+
+static void clean_up_on_signal(int signum) {
+    /* Don't start handling a signal we've been told to ignore,
+     * as when started in the background by a shell without
+     * job control.
+     */
+    if (signal(signum, terminating_signal_handler) == SIG_IGN) {
+        signal(signum, SIG_IGN);
+    }
+}
+
+void metrics_clean_up_on_exit() {
+    atexit(metrics_clean_up);
+    /* These are how a wl-copy running in the
+     * background normally gets terminated.
+     */
+    clean_up_on_signal(SIGTERM);
+    clean_up_on_signal(SIGINT);
+}
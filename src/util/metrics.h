@@ -0,0 +1,49 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTIL_METRICS_H
+#define UTIL_METRICS_H
+
+#include <stddef.h>
+
+/* Counters about serving paste requests, kept
+ * by a running wl-copy and dumped on request.
+ * There are no counters for transfers in progress
+ * or for losing the selection: serving a paste is
+ * synchronous, and wl-copy exits once it loses the
+ * selection, so a dump could never see either.
+ */
+
+void metrics_transfer_finished(
+    const char *mime_type,
+    size_t bytes,
+    double duration_ms
+);
+
+/* Writes the metrics into a file in XDG_RUNTIME_DIR */
+void metrics_dump(void);
+
+/* Removes the file written by metrics_dump(), if any */
+void metrics_clean_up(void);
+
+/* Arranges for metrics_clean_up() to be called when
+ * exiting normally or on SIGTERM or SIGINT.
+ */
+void metrics_clean_up_on_exit(void);
+
+#endif /* UTIL_METRICS_H */
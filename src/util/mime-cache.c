@@ -0,0 +1,338 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/mime-cache.h"
+#include "util/files.h"
+#include "util/hash.h"
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/file.h> // flock
+
+/* How many entries to keep */
+#define MAX_ENTRIES 64
+/* Stored in place of a type that could not be inferred */
+#define NO_TYPE "-"
+
+static const char cache_file_name[] = "wl-clipboard-mime-cache";
+/* The cache file itself gets replaced on each
+ * write, so lock a separate file instead.
+ */
+static const char lock_file_suffix[] = ".lock";
+
+struct entry {
+    char *key;
+    char *mime_type;
+};
+
+static char *get_cache_path(void) {
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir == NULL || runtime_dir[0] != '/') {
+        return NULL;
+    }
+    size_t len = strlen(runtime_dir) + 1 + strlen(cache_file_name) + 1;
+    char *path = malloc(len);
+    snprintf(path, len, "%s/%s", runtime_dir, cache_file_name);
+    return path;
+}
+
+char *mime_cache_key_for_fd(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return NULL;
+    }
+
+    /* The file name also factors into inference,
+     * and renaming a file doesn't change its mtime.
+     */
+    char *path = path_for_fd(fd);
+    if (path == NULL) {
+        return NULL;
+    }
+    unsigned long long path_hash = hash_string(path);
+    free(path);
+
+#ifdef HAVE_ST_MTIM
+    long mtime_nsec = st.st_mtim.tv_nsec;
+#else
+    long mtime_nsec = 0;
+#endif
+
+    char key[128];
+    snprintf(
+        key,
+        sizeof(key),
+        "file:%llx:%llx:%lld.%09ld:%lld:%016llx",
+        (unsigned long long) st.st_dev,
+        (unsigned long long) st.st_ino,
+        (long long) st.st_mtime,
+        mtime_nsec,
+        (long long) st.st_size,
+        path_hash
+    );
+    return strdup(key);
+}
+
+char *mime_cache_key_for_contents(const char *file_path) {
+    int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    /* Hash all of the contents, as what they get classified
+     * as, such as text or binary, depends on all of them.
+     */
+    uint64_t hash = HASH_INIT;
+    char buffer[64 * 1024];
+    while (1) {
+        ssize_t len = read(fd, buffer, sizeof(buffer));
+        if (len < 0 && errno == EINTR) {
+            continue;
+        } else if (len < 0) {
+            close(fd);
+            return NULL;
+        } else if (len == 0) {
+            break;
+        }
+        hash = hash_update(hash, buffer, len);
+    }
+    close(fd);
+
+    char key[64];
+    snprintf(
+        key,
+        sizeof(key),
+        "data:%016llx:%lld",
+        (unsigned long long) hash,
+        (long long) st.st_size
+    );
+    return strdup(key);
+}
+
+/* Takes an exclusive lock to serialize concurrent updates
+ * of the cache. Returns the fd to close to release it, or
+ * -1, in which case we go on without the lock.
+ */
+static int lock_cache(const char *path) {
+    size_t len = strlen(path) + sizeof(lock_file_suffix);
+    char *lock_path = malloc(len);
+    snprintf(lock_path, len, "%s%s", path, lock_file_suffix);
+    int fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    free(lock_path);
+    if (fd < 0) {
+        return -1;
+    }
+    while (flock(fd, LOCK_EX) < 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static void unlock_cache(int lock_fd) {
+    if (lock_fd >= 0) {
+        close(lock_fd);
+    }
+}
+
+/* Loads up to MAX_ENTRIES entries, the most recently used last */
+static size_t load_entries(const char *path, struct entry *entries) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (char line[512]; fgets(line, sizeof(line), f) != NULL;) {
+        /* Each line consists of a key and a type, separated by a tab */
+        char *tab = strchr(line, '\t');
+        char *newline = strchr(line, '\n');
+        if (tab == NULL || newline == NULL || newline < tab) {
+            /* Ignore malformed or truncated lines */
+            continue;
+        }
+        *tab = 0;
+        *newline = 0;
+        if (count == MAX_ENTRIES) {
+            /* Drop the oldest entry */
+            free(entries[0].key);
+            free(entries[0].mime_type);
+            memmove(entries, entries + 1, (count - 1) * sizeof(*entries));
+            count--;
+        }
+        entries[count].key = strdup(line);
+        entries[count].mime_type = strdup(tab + 1);
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+static void save_entries(
+    const char *path,
+    const struct entry *entries,
+    size_t count
+) {
+    /* Write a new file and atomically replace the old one,
+     * so concurrent readers never see a partial file.
+     */
+    size_t len = strlen(path) + sizeof(".XXXXXX");
+    char *temp_path = malloc(len);
+    snprintf(temp_path, len, "%s.XXXXXX", path);
+    int fd = mkstemp(temp_path);
+    if (fd < 0) {
+        free(temp_path);
+        return;
+    }
+    FILE *f = fdopen(fd, "w");
+    if (f == NULL) {
+        close(fd);
+        unlink(temp_path);
+        free(temp_path);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        fprintf(f, "%s\t%s\n", entries[i].key, entries[i].mime_type);
+    }
+    if (fclose(f) != 0 || rename(temp_path, path) < 0) {
+        unlink(temp_path);
+    }
+    free(temp_path);
+}
+
+static void free_entries(struct entry *entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(entries[i].key);
+        free(entries[i].mime_type);
+    }
+}
+
+/* Moves the entry with the given index to the end */
+static void touch_entry(struct entry *entries, size_t count, size_t index) {
+    struct entry entry = entries[index];
+    memmove(
+        entries + index,
+        entries + index + 1,
+        (count - index - 1) * sizeof(*entries)
+    );
+    entries[count - 1] = entry;
+}
+
+int mime_cache_lookup(const char *key, char **mime_type) {
+    char *path = get_cache_path();
+    if (path == NULL) {
+        return 0;
+    }
+
+    int lock_fd = lock_cache(path);
+    struct entry entries[MAX_ENTRIES];
+    size_t count = load_entries(path, entries);
+
+    int found = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(entries[i].key, key) != 0) {
+            continue;
+        }
+        found = 1;
+        if (strcmp(entries[i].mime_type, NO_TYPE) == 0) {
+            *mime_type = NULL;
+        } else {
+            *mime_type = strdup(entries[i].mime_type);
+        }
+        /* Only bother rewriting the file if the
+         * order of the entries actually changes.
+         */
+        if (i != count - 1) {
+            touch_entry(entries, count, i);
+            save_entries(path, entries, count);
+        }
+        break;
+    }
+
+    unlock_cache(lock_fd);
+    free_entries(entries, count);
+    free(path);
+    return found;
+}
+
+void mime_cache_store(const char *key, const char *mime_type) {
+    if (mime_type == NULL) {
+        mime_type = NO_TYPE;
+    }
+    /* Don't let weird types break the file format */
+    if (strpbrk(mime_type, "\t\n") != NULL) {
+        return;
+    }
+
+    char *path = get_cache_path();
+    if (path == NULL) {
+        return;
+    }
+
+    /* Hold the lock from loading the entries until we've
+     * written them back, so we don't lose entries stored
+     * by another wl-copy in the meantime.
+     */
+    int lock_fd = lock_cache(path);
+    struct entry entries[MAX_ENTRIES];
+    size_t count = load_entries(path, entries);
+
+    /* Replace an existing entry for the same key, if
+     * any, or else evict the least recently used one.
+     */
+    size_t index;
+    for (index = 0; index < count; index++) {
+        if (strcmp(entries[index].key, key) == 0) {
+            break;
+        }
+    }
+    if (index == count && count == MAX_ENTRIES) {
+        free(entries[0].key);
+        entries[0].key = strdup(key);
+        index = 0;
+    }
+    if (index < count) {
+        free(entries[index].mime_type);
+        entries[index].mime_type = strdup(mime_type);
+        touch_entry(entries, count, index);
+    } else {
+        entries[count].key = strdup(key);
+        entries[count].mime_type = strdup(mime_type);
+        count++;
+    }
+
+    save_entries(path, entries, count);
+    unlock_cache(lock_fd);
+    free_entries(entries, count);
+    free(path);
+}
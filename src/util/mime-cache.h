@@ -0,0 +1,46 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTIL_MIME_CACHE_H
+#define UTIL_MIME_CACHE_H
+
+/* A small cache of inferred MIME types that persists across
+ * invocations. It lives in $XDG_RUNTIME_DIR, keeps a bounded
+ * number of entries, and evicts the least recently used ones.
+ */
+
+/* These functions return owned strings, or NULL if the
+ * key cannot be computed. The first one only works for
+ * regular files, and keys them by their identity; the
+ * second one keys them by their contents.
+ */
+char *mime_cache_key_for_fd(int fd);
+char *mime_cache_key_for_contents(const char *file_path);
+
+/* Returns whether there was an entry for the key. If there
+ * was, the cached type is stored into *mime_type as an owned
+ * string, or NULL if the type could not be inferred.
+ */
+int mime_cache_lookup(const char *key, char **mime_type);
+
+/* Passing a NULL mime_type remembers that the type
+ * could not be inferred.
+ */
+void mime_cache_store(const char *key, const char *mime_type);
+
+#endif /* UTIL_MIME_CACHE_H */
@@ -0,0 +1,92 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/mime-table.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* Generated at build time by mime/generate-mime-table.py */
+#include "mime-table-data.h"
+
+#if MIME_TABLE_SIZE != 0
+/* No known type is anywhere near this long */
+#define MAX_NAME_LENGTH 256
+
+/* Must match mime_table_hash() in the generator */
+static uint32_t mime_table_hash(
+    const char *data,
+    size_t length,
+    uint32_t seed
+) {
+    uint32_t hash = 0x811c9dc5u ^ seed;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x01000193u;
+    }
+    /* Finalize to spread the bits */
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+#endif
+
+const struct mime_table_entry *mime_table_lookup(
+    const char *name,
+    size_t length
+) {
+#if MIME_TABLE_SIZE == 0
+    /* Built without shared-mime-info data. Check this
+     * with the preprocessor, as taking the remainder
+     * of the division by zero is undefined behavior.
+     */
+    (void) name;
+    (void) length;
+    return NULL;
+#else
+    /* The table is keyed by lowercase names. Only lowercase
+     * ASCII letters, the same way the generator does.
+     */
+    char key[MAX_NAME_LENGTH];
+    if (length > sizeof(key)) {
+        return NULL;
+    }
+    for (size_t i = 0; i < length; i++) {
+        char c = name[i];
+        key[i] = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    }
+
+    /* The table is a perfect hash: the first hash picks the
+     * seed for the second one, which gives us the only slot
+     * the name could possibly be in.
+     */
+    uint32_t bucket = mime_table_hash(key, length, 0)
+        % MIME_TABLE_BUCKET_COUNT;
+    uint32_t index = mime_table_hash(key, length, mime_table_seeds[bucket])
+        % MIME_TABLE_SIZE;
+
+    const struct mime_table_entry *entry = &mime_table_entries[index];
+    if (strncmp(entry->name, key, length) != 0 || entry->name[length] != 0) {
+        return NULL;
+    }
+    return entry;
+#endif
+}
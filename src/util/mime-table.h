@@ -0,0 +1,45 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTIL_MIME_TABLE_H
+#define UTIL_MIME_TABLE_H
+
+#include <stddef.h>
+
+/* The MIME types known to shared-mime-info at build time */
+struct mime_table_entry {
+    /* Lowercase */
+    const char *name;
+    /* The canonical name, if this is an alias */
+    const char *alias_of;
+    /* Whether the type is a subclass of text/plain,
+     * not set for aliases.
+     */
+    int is_text;
+};
+
+/* Looks up the first length bytes of the name, which lets
+ * callers skip any parameters. The lookup is case-insensitive,
+ * and doesn't resolve aliases. Returns NULL if unknown.
+ */
+const struct mime_table_entry *mime_table_lookup(
+    const char *name,
+    size_t length
+);
+
+#endif /* UTIL_MIME_TABLE_H */
@@ -0,0 +1,40 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTIL_PROBES_H
+#define UTIL_PROBES_H
+
+#include "config.h"
+
+/* Static tracing probes, for use with tools like
+ * bpftrace or perf. Without SDT support, these
+ * compile down to nothing.
+ */
+
+#ifdef HAVE_SDT
+#    include <sys/sdt.h>
+#    define PROBE(name) DTRACE_PROBE(wl_clipboard, name)
+#    define PROBE1(name, a) DTRACE_PROBE1(wl_clipboard, name, a)
+#    define PROBE2(name, a, b) DTRACE_PROBE2(wl_clipboard, name, a, b)
+#else
+#    define PROBE(name) do { } while (0)
+#    define PROBE1(name, a) do { } while (0)
+#    define PROBE2(name, a, b) do { } while (0)
+#endif
+
+#endif /* UTIL_PROBES_H */
@@ -17,13 +17,12 @@
  */
 
 #include "util/string.h"
+#include "util/mime-table.h"
 
 #include <string.h>
 #include <stdlib.h>
 
 int mime_type_is_text(const char *mime_type) {
-    /* A heuristic to detect plain text mime types */
-
     /* Types that explicitly declare they're textual */
     int basic
         = str_has_prefix(mime_type, "text/")
@@ -31,15 +30,6 @@ int mime_type_is_text(const char *mime_type) {
         || strcmp(mime_type, "STRING") == 0
         || strcmp(mime_type, "UTF8_STRING") == 0;
 
-    /* Common script and markup types */
-    int common
-        = strstr(mime_type, "json") != NULL
-        || str_has_suffix(mime_type, "script")
-        || str_has_suffix(mime_type, "xml")
-        || str_has_suffix(mime_type, "yaml")
-        || str_has_suffix(mime_type, "csv")
-        || str_has_suffix(mime_type, "ini");
-
     /* Special-case PGP and SSH keys.
      * A public SSH key is typically stored
      * in a file that has a name similar to
@@ -52,7 +42,33 @@ int mime_type_is_text(const char *mime_type) {
         = strstr(mime_type, "application/vnd.ms-publisher") != NULL
         || str_has_suffix(mime_type, "pgp-keys");
 
-    return basic || common || special;
+    if (basic || special) {
+        return 1;
+    }
+
+    /* See if shared-mime-info knows whether this
+     * type is textual, ignoring any parameters.
+     */
+    const struct mime_table_entry *entry = mime_table_lookup(
+        mime_type,
+        strcspn(mime_type, ";")
+    );
+    if (entry != NULL && entry->alias_of != NULL) {
+        entry = mime_table_lookup(entry->alias_of, strlen(entry->alias_of));
+    }
+    if (entry != NULL) {
+        return entry->is_text;
+    }
+
+    /* If not, fall back to a heuristic that
+     * detects common script and markup types.
+     */
+    return strstr(mime_type, "json") != NULL
+        || str_has_suffix(mime_type, "script")
+        || str_has_suffix(mime_type, "xml")
+        || str_has_suffix(mime_type, "yaml")
+        || str_has_suffix(mime_type, "csv")
+        || str_has_suffix(mime_type, "ini");
 }
 
 int str_has_prefix(const char *string, const char *prefix) {
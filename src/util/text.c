@@ -0,0 +1,156 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/text.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define ONES ((uint64_t) 0x0101010101010101ull)
+#define HIGH_BITS ((uint64_t) 0x8080808080808080ull)
+
+/* Whether all eight bytes in the word are printable
+ * ASCII characters, i.e. fall into 0x20..0x7e. This
+ * lets us skip over the common case of plain ASCII
+ * text a word at a time, without looking at every
+ * byte individually.
+ */
+static int word_is_printable_ascii(uint64_t word) {
+    /* Any bytes with the high bit set? */
+    if (word & HIGH_BITS) {
+        return 0;
+    }
+    /* Any bytes below 0x20? Since we know all bytes are
+     * below 0x80, subtracting 0x20 from each one sets the
+     * high bit exactly in those that were below 0x20.
+     */
+    if ((word - 0x20 * ONES) & HIGH_BITS) {
+        return 0;
+    }
+    /* Any 0x7f bytes? Same trick, after
+     * turning them into zero bytes.
+     */
+    uint64_t inverted = word ^ (0x7f * ONES);
+    if ((inverted - ONES) & ~inverted & HIGH_BITS) {
+        return 0;
+    }
+    return 1;
+}
+
+static int byte_is_allowed_control(unsigned char c) {
+    /* Bell, backspace, tab, newline, vertical tab,
+     * form feed, carriage return, and escape. This
+     * matches what file(1) considers to be text.
+     */
+    return (c >= 0x07 && c <= 0x0d) || c == 0x1b;
+}
+
+void text_scanner_init(struct text_scanner *self) {
+    self->is_text = 1;
+    self->continuation_bytes_left = 0;
+}
+
+static int scan_byte(struct text_scanner *self, unsigned char c) {
+    if (self->continuation_bytes_left > 0) {
+        if (c < self->next_min || c > self->next_max) {
+            return 0;
+        }
+        self->continuation_bytes_left--;
+        self->next_min = 0x80;
+        self->next_max = 0xbf;
+        return 1;
+    }
+
+    if (c < 0x20) {
+        return byte_is_allowed_control(c);
+    }
+    if (c < 0x7f) {
+        return 1;
+    }
+    if (c == 0x7f) {
+        return 0;
+    }
+
+    /* A leading byte of a multi-byte sequence. Restrict the
+     * range of the next byte to reject overlong encodings,
+     * surrogates, and code points above U+10FFFF.
+     */
+    self->next_min = 0x80;
+    self->next_max = 0xbf;
+    if (c >= 0xc2 && c <= 0xdf) {
+        self->continuation_bytes_left = 1;
+    } else if (c >= 0xe0 && c <= 0xef) {
+        self->continuation_bytes_left = 2;
+        if (c == 0xe0) {
+            self->next_min = 0xa0;
+        } else if (c == 0xed) {
+            self->next_max = 0x9f;
+        }
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        self->continuation_bytes_left = 3;
+        if (c == 0xf0) {
+            self->next_min = 0x90;
+        } else if (c == 0xf4) {
+            self->next_max = 0x8f;
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+int text_scanner_feed(
+    struct text_scanner *self,
+    const char *data,
+    size_t length
+) {
+    if (!self->is_text) {
+        return 0;
+    }
+
+    const unsigned char *ptr = (const unsigned char *) data;
+    const unsigned char *end = ptr + length;
+
+    while (ptr < end) {
+        if (
+            self->continuation_bytes_left == 0 &&
+            end - ptr >= (ptrdiff_t) sizeof(uint64_t)
+        ) {
+            uint64_t word;
+            memcpy(&word, ptr, sizeof(word));
+            if (word_is_printable_ascii(word)) {
+                ptr += sizeof(word);
+                continue;
+            }
+        }
+        if (!scan_byte(self, *ptr)) {
+            self->is_text = 0;
+            return 0;
+        }
+        ptr++;
+    }
+    return 1;
+}
+
+int text_scanner_finish(struct text_scanner *self) {
+    /* Make sure we're not in the middle of a sequence */
+    if (self->continuation_bytes_left > 0) {
+        self->is_text = 0;
+    }
+    return self->is_text;
+}
@@ -0,0 +1,48 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTIL_TEXT_H
+#define UTIL_TEXT_H
+
+#include <stddef.h>
+
+/* Incrementally checks whether a stream of bytes
+ * looks like plain text, meaning it is valid UTF-8
+ * and contains no control characters other than
+ * the usual whitespace ones and escape sequences.
+ */
+struct text_scanner {
+    int is_text;
+    /* State of the UTF-8 sequence we're in the middle of */
+    int continuation_bytes_left;
+    unsigned char next_min;
+    unsigned char next_max;
+};
+
+void text_scanner_init(struct text_scanner *self);
+
+/* Returns whether the data still looks like text */
+int text_scanner_feed(
+    struct text_scanner *self,
+    const char *data,
+    size_t length
+);
+
+int text_scanner_finish(struct text_scanner *self);
+
+#endif /* UTIL_TEXT_H */
@@ -0,0 +1,97 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "util/trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+static struct {
+    int enabled;
+    const char *program_name;
+    const char *backend;
+    struct timespec start;
+    struct timespec last;
+} state;
+
+static double ms_between(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+void trace_init(const char *program_name, int enabled) {
+    const char *env = getenv("WL_CLIPBOARD_TRACE");
+    if (env != NULL && env[0] != 0 && strcmp(env, "0") != 0) {
+        enabled = 1;
+    }
+    state.enabled = enabled;
+    state.program_name = program_name;
+    clock_gettime(CLOCK_MONOTONIC, &state.start);
+    state.last = state.start;
+}
+
+int trace_enabled() {
+    return state.enabled;
+}
+
+void trace_set_backend(const char *backend) {
+    state.backend = backend;
+}
+
+void trace(const char *phase, const char *format, ...) {
+    if (!state.enabled) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    /* Format the whole line first, so that lines from
+     * different processes don't get interleaved.
+     */
+    char line[512];
+    int len = snprintf(
+        line,
+        sizeof(line),
+        "%s: trace t=%.3fms dt=%.3fms phase=%s",
+        state.program_name,
+        ms_between(&state.start, &now),
+        ms_between(&state.last, &now),
+        phase
+    );
+    if (state.backend != NULL && len >= 0 && (size_t) len < sizeof(line)) {
+        len += snprintf(
+            line + len,
+            sizeof(line) - len,
+            " backend=%s",
+            state.backend
+        );
+    }
+    if (format != NULL && len >= 0 && (size_t) len < sizeof(line) - 1) {
+        line[len++] = ' ';
+        va_list args;
+        va_start(args, format);
+        vsnprintf(line + len, sizeof(line) - len, format, args);
+        va_end(args);
+    }
+    fprintf(stderr, "%s\n", line);
+
+    state.last = now;
+}
@@ -0,0 +1,38 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTIL_TRACE_H
+#define UTIL_TRACE_H
+
+/* Enables tracing if asked to, either explicitly
+ * or through the WL_CLIPBOARD_TRACE variable.
+ */
+void trace_init(const char *program_name, int enabled);
+
+int trace_enabled(void);
+
+/* Once set, the backend gets included in every line */
+void trace_set_backend(const char *backend);
+
+/* Prints a line about having reached the given phase,
+ * with the time since startup and since the previous
+ * line, followed by optional printf-style details.
+ */
+void trace(const char *phase, const char *format, ...);
+
+#endif /* UTIL_TRACE_H */
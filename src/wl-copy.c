@@ -21,12 +21,18 @@
 #include "types/device.h"
 #include "types/device-manager.h"
 #include "types/registry.h"
+#include "types/seat.h"
 #include "types/popup-surface.h"
 #include "types/offer.h"
+#include "types/event-loop.h"
 
 #include "util/files.h"
 #include "util/string.h"
 #include "util/misc.h"
+#include "util/mime-cache.h"
+#include "util/trace.h"
+#include "util/metrics.h"
+#include "util/probes.h"
 
 #include <wayland-client.h>
 #include <unistd.h>
@@ -35,18 +41,107 @@
 #include <libgen.h>
 #include <getopt.h>
 #include <signal.h>
+#include <errno.h>
+#include <sys/wait.h>
 
 static struct {
     int stay_in_foreground;
+    int early_detach;
     int clear;
     char *mime_type;
     int trim_newline;
     int paste_once;
     int primary;
     int sensitive;
+    int trace;
     const char *seat_name;
 } options;
 
+/* The copying of our stdin that may still be in progress */
+static struct {
+    pid_t pid;
+    char *temp_file;
+    /* The process that has started the ingestion */
+    pid_t owner;
+} ingestion;
+
+static void clean_up_ingestion(void) {
+    if (ingestion.temp_file == NULL) {
+        return;
+    }
+    /* Don't let forked children that happen
+     * to exit() delete the file under us.
+     */
+    if (getpid() != ingestion.owner) {
+        return;
+    }
+    /* We're exiting before having finished setting
+     * things up, so make sure not to leave the temp
+     * file and the copying process around.
+     */
+    if (ingestion.pid > 0) {
+        kill(ingestion.pid, SIGTERM);
+        waitpid(ingestion.pid, NULL, 0);
+    }
+    unlink(ingestion.temp_file);
+    rmdir(dirname(ingestion.temp_file));
+}
+
+/* The write end of a pipe we use to get notified
+ * about SIGUSR1 from inside of our event loop.
+ */
+static int metrics_pipe_write_fd = -1;
+
+static void sigusr1_handler(int signum) {
+    int saved_errno = errno;
+    ssize_t rc = write(metrics_pipe_write_fd, "", 1);
+    /* If the pipe is full, a dump is already pending */
+    (void) rc;
+    errno = saved_errno;
+}
+
+static void on_metrics_requested(void *data, int fd) {
+    char buffer[16];
+    while (read(fd, buffer, sizeof(buffer)) > 0);
+    metrics_dump();
+}
+
+static void set_up_metrics(struct event_loop *event_loop) {
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        perror("pipe");
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(pipefd[i], F_SETFD, FD_CLOEXEC);
+        fcntl(pipefd[i], F_SETFL, O_NONBLOCK);
+    }
+    metrics_pipe_write_fd = pipefd[1];
+    event_loop_add_fd(event_loop, pipefd[0], on_metrics_requested, NULL);
+    signal(SIGUSR1, sigusr1_handler);
+    metrics_clean_up_on_exit();
+}
+
+static void fork_into_background(void) {
+    signal(SIGHUP, SIG_IGN);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        /* Proceed without forking */
+    }
+    if (pid > 0) {
+        exit(0);
+    }
+}
+
+static void start_ingestion(void) {
+    ingestion.owner = getpid();
+    ingestion.pid = start_dumping_stdin_into_a_temp_file(
+        &ingestion.temp_file
+    );
+    atexit(clean_up_ingestion);
+}
+
 static void did_set_selection_callback(struct copy_action *copy_action) {
     if (options.clear) {
         exit(0);
@@ -78,14 +173,9 @@ static void did_set_selection_callback(struct copy_action *copy_action) {
         if (chdir("/") < 0) {
             perror("chdir /");
         }
-        signal(SIGHUP, SIG_IGN);
-        pid_t pid = fork();
-        if (pid < 0) {
-            perror("fork");
-            /* Proceed without forking */
-        }
-        if (pid > 0) {
-            exit(0);
+        /* With --early-detach, we're already there */
+        if (!options.early_detach) {
+            fork_into_background();
         }
     }
 }
@@ -100,13 +190,49 @@ static void pasted_callback(struct copy_action *copy_action) {
     }
 }
 
-static void selection_callback(struct offer *offer, int primary) {
+static void selection_callback(
+    struct device *device,
+    struct offer *offer,
+    int primary
+) {
     /* We're not interested */
     if (offer != NULL) {
         offer_destroy(offer);
     }
 }
 
+static char *infer_mime_type(const char *temp_file) {
+    PROBE(infer_begin);
+    /* Copying the same file over and over again is common,
+     * so see if we have already inferred its type before.
+     */
+    char *cache_key = mime_cache_key_for_fd(STDIN_FILENO);
+    if (cache_key == NULL) {
+        cache_key = mime_cache_key_for_contents(temp_file);
+    }
+    char *mime_type;
+    if (cache_key != NULL && mime_cache_lookup(cache_key, &mime_type)) {
+        free(cache_key);
+        PROBE1(infer_end, mime_type);
+        return mime_type;
+    }
+
+    mime_type = infer_mime_type_from_contents(temp_file);
+    if (mime_type == NULL && !file_looks_like_text(temp_file)) {
+        /* We couldn't figure out the type, and the contents
+         * are not text either, so don't offer them as text.
+         */
+        mime_type = strdup(application_octet_stream);
+    }
+
+    if (cache_key != NULL) {
+        mime_cache_store(cache_key, mime_type);
+        free(cache_key);
+    }
+    PROBE1(infer_end, mime_type);
+    return mime_type;
+}
+
 static void print_usage(FILE *f, const char *argv0) {
     fprintf(
         f,
@@ -117,6 +243,8 @@ static void print_usage(FILE *f, const char *argv0) {
         "Options:\n"
         "\t-o, --paste-once\tOnly serve one paste request and then exit.\n"
         "\t-f, --foreground\tStay in the foreground instead of forking.\n"
+        "\t    --early-detach\t"
+        "Fork before reading the content and setting the selection.\n"
         "\t-c, --clear\t\tInstead of copying, clear the clipboard.\n"
         "\t-p, --primary\t\tUse the \"primary\" clipboard.\n"
         "\t-n, --trim-newline\tDo not copy the trailing newline character.\n"
@@ -125,6 +253,7 @@ static void print_usage(FILE *f, const char *argv0) {
         "\t    --sensitive\t\tHint that the content is sensitive.\n"
         "\t-s, --seat seat-name\t"
         "Pick the seat to work with.\n"
+        "\t    --trace\t\tPrint timing info about each phase.\n"
         "\t-v, --version\t\tDisplay version info.\n"
         "\t-h, --help\t\tDisplay this message.\n"
         "Mandatory arguments to long options are mandatory"
@@ -147,10 +276,12 @@ static void parse_options(int argc, argv_t argv) {
         {"trim-newline", no_argument, 0, 'n'},
         {"paste-once", no_argument, 0, 'o'},
         {"foreground", no_argument, 0, 'f'},
+        {"early-detach", no_argument, 0, 'D'},
         {"clear", no_argument, 0, 'c'},
         {"type", required_argument, 0, 't'},
         {"sensitive", no_argument, 0, 'S'},
         {"seat", required_argument, 0, 's'},
+        {"trace", no_argument, 0, 'T'},
         {0, 0, 0, 0}
     };
     while (1) {
@@ -182,6 +313,9 @@ static void parse_options(int argc, argv_t argv) {
         case 'f':
             options.stay_in_foreground = 1;
             break;
+        case 'D':
+            options.early_detach = 1;
+            break;
         case 'c':
             options.clear = 1;
             break;
@@ -194,6 +328,9 @@ static void parse_options(int argc, argv_t argv) {
         case 's':
             options.seat_name = strdup(optarg);
             break;
+        case 'T':
+            options.trace = 1;
+            break;
         default:
             /* getopt has already printed an error message */
             print_usage(stderr, argv[0]);
@@ -204,6 +341,7 @@ static void parse_options(int argc, argv_t argv) {
 
 int main(int argc, argv_t argv) {
     parse_options(argc, argv);
+    trace_init("wl-copy", options.trace);
 
     /* Ignore SIGPIPE.
      * We don't really output anything
@@ -213,6 +351,24 @@ int main(int argc, argv_t argv) {
      */
     signal(SIGPIPE, SIG_IGN);
 
+    /* --foreground takes precedence */
+    if (options.stay_in_foreground) {
+        options.early_detach = 0;
+    }
+
+    /* Start copying data from our stdin right away, so
+     * that it happens concurrently with us connecting
+     * to the compositor and looking up the seat and the
+     * device. If stdin is closed, leave it alone; the
+     * connection will end up taking its place, and we
+     * will complain about that below.
+     */
+    int copy_stdin = !options.clear && optind >= argc;
+    int stdin_is_open = fcntl(STDIN_FILENO, F_GETFD) >= 0;
+    if (copy_stdin && stdin_is_open && !options.early_detach) {
+        start_ingestion();
+    }
+
     struct wl_display *wl_display = wl_display_connect(NULL);
     if (wl_display == NULL) {
         complain_about_wayland_connection();
@@ -220,18 +376,37 @@ int main(int argc, argv_t argv) {
     if (wl_display_get_fd(wl_display) <= STDERR_FILENO) {
         complain_about_closed_stdio(wl_display);
     }
+    trace("connect", NULL);
+
+    if (options.early_detach) {
+        /* We're connected, so return control to our
+         * caller, and do everything else (including
+         * copying our stdin) in the background. Any
+         * errors still get reported to stderr. The
+         * copying has to be started after forking,
+         * so that the copying process is our child.
+         */
+        fork_into_background();
+        if (copy_stdin) {
+            start_ingestion();
+        }
+    }
 
     struct registry *registry = calloc(1, sizeof(struct registry));
     registry->wl_display = wl_display;
     registry_init(registry);
 
     /* Wait for the initial set of globals to appear */
+    PROBE(roundtrip_begin);
     wl_display_roundtrip(wl_display);
+    PROBE(roundtrip_end);
+    trace("globals", NULL);
 
     struct seat *seat = registry_find_seat(registry, options.seat_name);
     if (seat == NULL) {
         complain_about_missing_seat(options.seat_name);
     }
+    trace("seat", "name=%s", seat->name != NULL ? seat->name : "?");
 
     /* Create the device */
     struct device_manager *device_manager
@@ -242,10 +417,13 @@ int main(int argc, argv_t argv) {
 
     struct device *device = device_manager_get_device(device_manager, seat);
     device->selection_callback = selection_callback;
+    trace_set_backend(device_manager->name);
+    trace("device", NULL);
 
     if (!device_supports_selection(device, options.primary)) {
         complain_about_selection_support(options.primary);
     }
+    trace("support-check", "primary=%d", options.primary);
 
     /* Create and initialize the copy action */
     struct copy_action *copy_action = calloc(1, sizeof(struct copy_action));
@@ -259,19 +437,28 @@ int main(int argc, argv_t argv) {
             /* Copy our command-line arguments */
             copy_action->argv_to_copy = &argv[optind];
         } else {
-            /* Copy data from our stdin.
-             * It's important that we only do this
-             * after going through the initial stages
-             * that are likely to result in errors,
-             * so that we don't forget to clean up
-             * the temp file.
+            /* Wait for the copying of our stdin to
+             * complete. We only get here once we have
+             * gone through the initial stages that are
+             * likely to result in errors; if we fail
+             * before that, clean_up_ingestion() takes
+             * care of the temp file.
              */
-            char *temp_file = dump_stdin_into_a_temp_file();
+            pid_t pid = ingestion.pid;
+            ingestion.pid = 0;
+            finish_dumping_stdin_into_a_temp_file(pid);
+            trace("ingest", NULL);
+            char *temp_file = ingestion.temp_file;
             if (options.trim_newline) {
                 trim_trailing_newline(temp_file);
             }
             if (options.mime_type == NULL) {
-                options.mime_type = infer_mime_type_from_contents(temp_file);
+                options.mime_type = infer_mime_type(temp_file);
+                trace(
+                    "infer",
+                    "type=%s",
+                    options.mime_type != NULL ? options.mime_type : "-"
+                );
             }
             copy_action->fd_to_copy_from = open(
                 temp_file,
@@ -295,6 +482,7 @@ int main(int argc, argv_t argv) {
                 perror("Failed to remove temp file directory");
             }
             free(temp_file);
+            ingestion.temp_file = NULL;
         }
 
         /* Create the source */
@@ -315,6 +503,7 @@ int main(int argc, argv_t argv) {
         if (options.sensitive) {
             source_offer(copy_action->source, x_kde_password_manager_hint);
         }
+        trace("source-offer", NULL);
     }
 
     if (device->needs_popup_surface) {
@@ -326,9 +515,15 @@ int main(int argc, argv_t argv) {
     copy_action->did_set_selection_callback = did_set_selection_callback;
     copy_action->pasted_callback = pasted_callback;
     copy_action->cancelled_callback = cancelled_callback;
+
+    /* Dump metrics about serving pastes on SIGUSR1 */
+    struct event_loop event_loop = { .wl_display = wl_display };
+    event_loop_init(&event_loop);
+    set_up_metrics(&event_loop);
+
     copy_action_init(copy_action);
 
-    while (wl_display_dispatch(wl_display) >= 0);
+    while (event_loop_dispatch(&event_loop, -1) >= 0);
 
     perror("wl_display_dispatch");
     return 1;
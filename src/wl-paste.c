@@ -16,15 +16,25 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "config.h"
 #include "types/offer.h"
 #include "types/device.h"
 #include "types/device-manager.h"
 #include "types/registry.h"
+#include "types/seat.h"
 #include "types/popup-surface.h"
+#include "types/watch-sink.h"
+#include "types/event-loop.h"
 
 #include "util/files.h"
 #include "util/string.h"
+#include "util/text.h"
+#include "util/hash.h"
+#include "util/json.h"
 #include "util/misc.h"
+#include "util/atom.h"
+#include "util/trace.h"
+#include "util/probes.h"
 
 #include <wayland-client.h>
 #include <unistd.h>
@@ -35,7 +45,17 @@
 #include <getopt.h>
 #include <ctype.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
 #include <wayland-util.h>
+#include <fnmatch.h>
+#include <regex.h>
+
+#ifdef HAVE_PIDFD
+#    include <sys/syscall.h> // syscall, SYS_pidfd_open
+#endif
 
 static struct {
     char *explicit_type;
@@ -43,9 +63,32 @@ static struct {
     int no_newline;
     int list_types;
     int primary;
+    int both_selections;
     int watch;
     argv_t watch_command;
+    void (*watch_sink_init)(struct watch_sink *sink);
+    const char *watch_sink_path;
+    char *watch_separator;
+    int debounce;
+    int coalesce;
+    int watch_no_data;
+    int watch_json;
+    int watch_json_inline;
+    int watch_dedup;
+    int watch_memfd;
+    /* Filters, as char * glob patterns */
+    struct wl_array watch_type_patterns;
+    int watch_has_regex;
+    regex_t watch_regex;
+    int watch_max_size;
+    int watch_jobs;
+    enum {
+        WATCH_QUEUE_ALL,
+        WATCH_QUEUE_DROP_OLDEST,
+        WATCH_QUEUE_LATEST
+    } watch_queue_policy;
     const char *seat_name;
+    int trace;
 } options;
 
 struct types {
@@ -54,59 +97,147 @@ struct types {
     int plain_text_utf8_available;
     int plain_text_available;
     int has_sensitive_hint;
-    const char *having_explicit_as_prefix;
-    const char *any_text;
-    const char *any;
+    atom_t having_explicit_as_prefix;
+    atom_t any_text;
+    atom_t any;
 };
 
 static struct wl_display *wl_display = NULL;
+static struct event_loop event_loop;
+static struct device_manager *device_manager = NULL;
 static struct popup_surface *popup_surface = NULL;
 static int offer_received = 0;
+static struct watch_sink *watch_sink = NULL;
 
-static struct types classify_offer_types(struct offer *offer) {
-    struct types types = { 0 };
-    offer_for_each_mime_type(offer, mime_type) {
-        if (
-            options.explicit_type != NULL &&
-            strcmp(mime_type, options.explicit_type) == 0
-        ) {
-            types.explicit_available = 1;
-        }
+/* A selection we have been notified about */
+struct selection {
+    /* NULL if the selection has been cleared */
+    struct offer *offer;
+    int primary;
+    struct seat *seat;
+};
+
+static const char *seat_name_of(const struct selection *selection) {
+    if (selection->seat == NULL) {
+        return NULL;
+    }
+    return selection->seat->name;
+}
+
+/* What we keep track of for each selection we watch, i.e. for
+ * the regular and the primary selection of each of the seats.
+ */
+struct watched {
+    struct seat *seat;
+    int primary;
+    /* With --debounce or --coalesce, the latest
+     * selection we have not processed yet.
+     */
+    int pending;
+    struct selection selection;
+    struct timespec deadline;
+    /* With --watch-dedup, the hash of the last data we've handled */
+    int seen;
+    uint64_t hash;
+};
+static struct wl_array watched;
+
+/* The returned pointer is only valid until the next call */
+static struct watched *watched_for(const struct selection *selection) {
+    struct watched *ptr;
+    wl_array_for_each(ptr, &watched) {
         if (
-            options.inferred_type != NULL &&
-            strcmp(mime_type, options.inferred_type) == 0
+            ptr->seat == selection->seat &&
+            ptr->primary == selection->primary
         ) {
-            types.inferred_available = 1;
-        }
-        if (strcmp(mime_type, text_plain_utf8) == 0) {
-            types.plain_text_utf8_available = 1;
+            return ptr;
         }
-        if (strcmp(mime_type, text_plain) == 0) {
-            types.plain_text_available = 1;
+    }
+    ptr = wl_array_add(&watched, sizeof(struct watched));
+    memset(ptr, 0, sizeof(struct watched));
+    ptr->seat = selection->seat;
+    ptr->primary = selection->primary;
+    return ptr;
+}
+
+/* In watch mode, selections waiting for a job to handle them,
+ * along with their data. We receive the data right away, as
+ * the source might well be gone by the time a job is free.
+ */
+struct queued {
+    struct selection selection;
+    int fd;
+    const char *state;
+};
+#define WATCH_QUEUE_LIMIT 64
+static struct wl_array watch_queue;
+
+/* Commands we have spawned, until they have exited
+ * and we have written out their output.
+ */
+struct job {
+    pid_t pid;
+    /* -1 once the command has exited */
+    int pidfd;
+    struct offer *offer;
+    /* With --watch-jobs larger than one, the output of the
+     * command, which we only write out once the commands for
+     * all the earlier selections have written theirs; or -1.
+     */
+    int output_fd;
+    unsigned long sequence;
+};
+static struct wl_array jobs;
+static int running_jobs = 0;
+static unsigned long next_job_sequence = 0;
+static unsigned long next_output_sequence = 0;
+
+/* The explicit and inferred types, interned */
+static atom_t explicit_atom = ATOM_NONE;
+static atom_t inferred_atom = ATOM_NONE;
+
+static struct types classify_offer_types(struct offer *offer) {
+    struct types types = { 0 };
+
+    /* Look up the specific types we're interested in directly */
+    types.explicit_available = offer_has_atom(offer, explicit_atom);
+    types.inferred_available = offer_has_atom(offer, inferred_atom);
+    types.plain_text_utf8_available
+        = offer_has_atom(offer, ATOM_TEXT_PLAIN_UTF8);
+    types.plain_text_available = offer_has_atom(offer, ATOM_TEXT_PLAIN);
+    /* We should be checking if it contains
+     * the string "secret" as opposed to "public",
+     * but for now let's just use the presence
+     * of the type as an indication.
+     */
+    types.has_sensitive_hint
+        = offer_has_atom(offer, ATOM_X_KDE_PASSWORD_MANAGER_HINT);
+
+    size_t count = offer_get_mime_type_count(offer);
+    if (count == 0) {
+        return types;
+    }
+    types.any = offer_get_atom(offer, 0);
+
+    /* Only scan the list for what can't be looked up */
+    int need_prefixed = options.explicit_type != NULL;
+    for (size_t i = 0; i < count; i++) {
+        atom_t atom = offer_get_atom(offer, i);
+        if (types.any_text == ATOM_NONE && atom_is_text(atom)) {
+            types.any_text = atom;
         }
         if (
-            types.any_text == NULL &&
-            mime_type_is_text(mime_type)
+            need_prefixed &&
+            types.having_explicit_as_prefix == ATOM_NONE &&
+            str_has_prefix(atom_name(atom), options.explicit_type)
         ) {
-            types.any_text = mime_type;
-        }
-        if (types.any == NULL) {
-            types.any = mime_type;
+            types.having_explicit_as_prefix = atom;
         }
         if (
-            options.explicit_type != NULL &&
-            types.having_explicit_as_prefix == NULL &&
-            str_has_prefix(mime_type, options.explicit_type)
+            types.any_text != ATOM_NONE &&
+            (!need_prefixed || types.having_explicit_as_prefix != ATOM_NONE)
         ) {
-            types.having_explicit_as_prefix = mime_type;
-        }
-        if (strcmp(mime_type, x_kde_password_manager_hint) == 0) {
-            /* We should be checking if it contains
-             * the string "secret" as opposed to "public",
-             * but for now let's just use the presence
-             * of the type as an indication.
-             */
-            types.has_sensitive_hint = 1;
+            break;
         }
     }
     return types;
@@ -114,33 +245,33 @@ static struct types classify_offer_types(struct offer *offer) {
 
 #define try_explicit \
 if (types.explicit_available) \
-    return options.explicit_type
+    return explicit_atom
 
 #define try_inferred \
 if (types.inferred_available) \
-    return options.inferred_type
+    return inferred_atom
 
 #define try_text_plain_utf8 \
 if (types.plain_text_utf8_available) \
-    return text_plain_utf8
+    return ATOM_TEXT_PLAIN_UTF8
 
 #define try_text_plain \
 if (types.plain_text_available) \
-    return text_plain
+    return ATOM_TEXT_PLAIN
 
 #define try_prefixed \
-if (types.having_explicit_as_prefix != NULL) \
+if (types.having_explicit_as_prefix != ATOM_NONE) \
     return types.having_explicit_as_prefix
 
 #define try_any_text \
-if (types.any_text != NULL) \
+if (types.any_text != ATOM_NONE) \
     return types.any_text
 
 #define try_any \
-if (types.any != NULL) \
+if (types.any != ATOM_NONE) \
     return types.any
 
-static const char *mime_type_to_request(struct types types) {
+static atom_t mime_type_to_request(struct types types) {
     if (options.explicit_type != NULL) {
         if (strcmp(options.explicit_type, "text") == 0) {
             try_text_plain_utf8;
@@ -163,7 +294,7 @@ static const char *mime_type_to_request(struct types types) {
             try_text_plain;
             try_any_text;
             try_any;
-        } else if (mime_type_is_text(options.inferred_type)) {
+        } else if (atom_is_text(inferred_atom)) {
             try_inferred;
             try_text_plain_utf8;
             try_text_plain;
@@ -172,7 +303,7 @@ static const char *mime_type_to_request(struct types types) {
             try_inferred;
         }
     }
-    return NULL;
+    return ATOM_NONE;
 }
 
 #undef try_explicit
@@ -183,7 +314,51 @@ static const char *mime_type_to_request(struct types types) {
 #undef try_any_text
 #undef try_any
 
-static int run_paste_command(int stdin_fd, const char *clipboard_state) {
+/* If we've received the data upfront, the command can
+ * know its size without having to read it all.
+ */
+static void export_size_of_stdin(void) {
+    struct stat st;
+    if (fstat(STDIN_FILENO, &st) < 0 || !S_ISREG(st.st_mode)) {
+        unsetenv("CLIPBOARD_SIZE");
+        return;
+    }
+    char size[32];
+    snprintf(size, sizeof(size), "%lld", (long long) st.st_size);
+    setenv("CLIPBOARD_SIZE", size, 1);
+}
+
+/* Exports the offered types, one per line */
+static void export_offered_types(struct offer *offer) {
+    if (offer == NULL) {
+        setenv("CLIPBOARD_TYPES", "", 1);
+        return;
+    }
+    /* The types are already stored back to back,
+     * we just have to turn NULs into newlines.
+     */
+    size_t size = offer->offered_mime_types.size;
+    char *types = malloc(size + 1);
+    memcpy(types, offer->offered_mime_types.data, size);
+    types[size] = 0;
+    for (size_t i = 0; i + 1 < size; i++) {
+        if (types[i] == 0) {
+            types[i] = '\n';
+        }
+    }
+    setenv("CLIPBOARD_TYPES", types, 1);
+    free(types);
+}
+
+/* Unless stdout_fd is negative, the command
+ * gets it as its standard output.
+ */
+static pid_t spawn_paste_command(
+    int stdin_fd,
+    int stdout_fd,
+    const char *clipboard_state,
+    const struct selection *selection
+) {
     /* Spawn a cat to perform the copy.
      * If watch mode is active, we spawn
      * a custom command instead.
@@ -192,15 +367,29 @@ static int run_paste_command(int stdin_fd, const char *clipboard_state) {
     if (pid < 0) {
         perror("fork");
         close(stdin_fd);
-        return 0;
+        return -1;
     }
     if (pid == 0) {
         dup2(stdin_fd, STDIN_FILENO);
         close(stdin_fd);
+        if (stdout_fd >= 0) {
+            dup2(stdout_fd, STDOUT_FILENO);
+            close(stdout_fd);
+        }
         if (options.watch) {
             if (clipboard_state != NULL) {
                 setenv("CLIPBOARD_STATE", clipboard_state, 1);
             }
+            export_offered_types(selection->offer);
+            setenv(
+                "CLIPBOARD_SELECTION",
+                selection->primary ? "primary" : "clipboard",
+                1
+            );
+            if (seat_name_of(selection) != NULL) {
+                setenv("CLIPBOARD_SEAT", seat_name_of(selection), 1);
+            }
+            export_size_of_stdin();
             execvp(options.watch_command[0], options.watch_command);
             fprintf(
                 stderr,
@@ -212,15 +401,459 @@ static int run_paste_command(int stdin_fd, const char *clipboard_state) {
             execlp("cat", "cat", NULL);
             perror("exec cat");
         }
-        exit(1);
+        _exit(1);
     }
     close(stdin_fd);
+    return pid;
+}
+
+static int run_paste_command(
+    int stdin_fd,
+    const char *clipboard_state,
+    const struct selection *selection
+) {
+    pid_t pid = spawn_paste_command(
+        stdin_fd,
+        -1,
+        clipboard_state,
+        selection
+    );
+    if (pid < 0) {
+        return 0;
+    }
     waitpid(pid, NULL, 0);
     return 1;
 }
 
+static void start_jobs(void);
+
+#ifdef HAVE_PIDFD
+
+/* Writes out the output of the jobs that have exited, in
+ * the order they have been started in, and forgets them.
+ */
+static void flush_exited_jobs(void) {
+    while (1) {
+        struct job *job;
+        struct job *found = NULL;
+        wl_array_for_each(job, &jobs) {
+            if (job->sequence == next_output_sequence) {
+                found = job;
+                break;
+            }
+        }
+        if (found == NULL || found->pidfd >= 0) {
+            return;
+        }
+        if (found->output_fd >= 0) {
+            if (
+                lseek(found->output_fd, 0, SEEK_SET) < 0 ||
+                !copy_fd_contents(found->output_fd, STDOUT_FILENO, NULL)
+            ) {
+                perror("Failed to write out command output");
+            }
+            close(found->output_fd);
+        }
+        /* Move the last job into its place */
+        struct job *last = (struct job *) (
+            (char *) jobs.data + jobs.size - sizeof(struct job)
+        );
+        *found = *last;
+        jobs.size -= sizeof(struct job);
+        next_output_sequence++;
+    }
+}
+
+static void on_job_exited(void *data, int pidfd) {
+    struct job *job;
+    wl_array_for_each(job, &jobs) {
+        if (job->pidfd != pidfd) {
+            continue;
+        }
+        waitpid(job->pid, NULL, 0);
+        event_loop_remove_fd(&event_loop, pidfd);
+        close(pidfd);
+        job->pidfd = -1;
+        if (job->offer != NULL) {
+            offer_destroy(job->offer);
+            job->offer = NULL;
+        }
+        trace("job-exited", "pid=%ld", (long) job->pid);
+        running_jobs--;
+        break;
+    }
+    flush_exited_jobs();
+    start_jobs();
+}
+
+/* Runs the command without waiting for it, keeping
+ * the offer alive until it exits. Takes ownership
+ * of the offer.
+ */
+static void start_job(
+    int stdin_fd,
+    const char *clipboard_state,
+    struct selection selection
+) {
+    struct offer *offer = selection.offer;
+    /* Commands running at the same time would otherwise
+     * mix up their output, so have each one write it into
+     * a file, and write those out in order.
+     */
+    int output_fd = -1;
+    if (options.watch_jobs > 1) {
+        output_fd = create_anonymous_file();
+        if (output_fd < 0) {
+            perror("Failed to create a buffer file");
+            close(stdin_fd);
+            if (offer != NULL) {
+                offer_destroy(offer);
+            }
+            return;
+        }
+    }
+    pid_t pid = spawn_paste_command(
+        stdin_fd,
+        output_fd,
+        clipboard_state,
+        &selection
+    );
+    if (pid < 0) {
+        if (output_fd >= 0) {
+            close(output_fd);
+        }
+        if (offer != NULL) {
+            offer_destroy(offer);
+        }
+        return;
+    }
+
+    struct job *job = wl_array_add(&jobs, sizeof(struct job));
+    job->pid = pid;
+    job->pidfd = syscall(SYS_pidfd_open, pid, 0);
+    job->offer = offer;
+    job->output_fd = output_fd;
+    job->sequence = next_job_sequence++;
+    if (job->pidfd < 0) {
+        /* Probably an older kernel; just wait for it */
+        waitpid(pid, NULL, 0);
+        if (offer != NULL) {
+            offer_destroy(offer);
+            job->offer = NULL;
+        }
+        flush_exited_jobs();
+        return;
+    }
+    running_jobs++;
+    event_loop_add_fd(&event_loop, job->pidfd, on_job_exited, NULL);
+}
+
+#else
+
+static void start_job(
+    int stdin_fd,
+    const char *clipboard_state,
+    struct selection selection
+) {
+    /* Without pidfd support, run the command synchronously */
+    run_paste_command(stdin_fd, clipboard_state, &selection);
+    if (selection.offer != NULL) {
+        offer_destroy(selection.offer);
+    }
+}
+
+#endif /* HAVE_PIDFD */
+
+static int write_to_sink(
+    int pipe_fd,
+    atom_t mime_type,
+    const char *state,
+    const struct selection *selection
+) {
+    /* Sinks want to know the size of the data upfront,
+     * so read it all into an anonymous file first.
+     */
+    int fd = create_anonymous_file();
+    if (fd < 0) {
+        perror("Failed to create a buffer file");
+        close(pipe_fd);
+        return 0;
+    }
+    size_t size = 0;
+    int rc = copy_fd_contents(pipe_fd, fd, &size);
+    close(pipe_fd);
+    if (!rc) {
+        perror("Failed to receive data");
+        close(fd);
+        return 0;
+    }
+    rc = watch_sink_write(
+        watch_sink,
+        fd,
+        size,
+        atom_name(mime_type),
+        state,
+        seat_name_of(selection)
+    );
+    close(fd);
+    return rc;
+}
+
+/* How much of the data --watch-if-match looks at */
+#define WATCH_MATCH_LIMIT (64 * 1024)
+
+static int offer_passes_type_filter(struct offer *offer) {
+    if (options.watch_type_patterns.size == 0) {
+        return 1;
+    }
+    char **pattern;
+    wl_array_for_each(pattern, &options.watch_type_patterns) {
+        offer_for_each_mime_type(offer, mime_type) {
+            if (fnmatch(*pattern, mime_type, 0) == 0) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* The prefix must have room for one more byte */
+static int prefix_matches_regex(char *prefix, size_t length) {
+    /* Binary data is effectively cut off at the first NUL */
+    prefix[length] = 0;
+    return regexec(&options.watch_regex, prefix, 0, NULL, 0) == 0;
+}
+
+/* Whether we need to receive all of the data
+ * before deciding whether to handle it, or
+ * before handing it off, such as when it has
+ * to wait in the queue.
+ */
+static int need_to_inspect_data(void) {
+    return options.watch_memfd
+        || running_jobs >= options.watch_jobs
+        || options.watch_dedup
+        || options.watch_has_regex
+        || options.watch_max_size >= 0;
+}
+
+/* Receives the data into an anonymous file, hashing it and
+ * checking it against the filters as it arrives, so that we
+ * can stop receiving as soon as it fails them. Returns the
+ * file, rewound to the start, or -1 if the data doesn't pass
+ * the filters, is the same as we've last seen for this
+ * selection, or on errors.
+ */
+static int receive_and_inspect(
+    int pipe_fd,
+    atom_t mime_type,
+    const struct selection *selection
+) {
+    int fd;
+    if (options.watch_memfd) {
+        fd = create_sealable_file();
+    } else {
+        fd = create_anonymous_file();
+    }
+    if (fd < 0) {
+        perror("Failed to create a buffer file");
+        close(pipe_fd);
+        return -1;
+    }
+    /* The same bytes in another type are a different selection */
+    uint64_t hash = hash_string(atom_name(mime_type));
+    size_t size = 0;
+    /* The beginning of the data, for --watch-if-match */
+    char *prefix = NULL;
+    size_t prefix_length = 0;
+    if (options.watch_has_regex) {
+        prefix = malloc(WATCH_MATCH_LIMIT + 1);
+    }
+
+    char buffer[64 * 1024];
+    while (1) {
+        ssize_t len = read(pipe_fd, buffer, sizeof(buffer));
+        if (len < 0 && errno == EINTR) {
+            continue;
+        } else if (len < 0) {
+            perror("Failed to receive data");
+            goto skip;
+        } else if (len == 0) {
+            break;
+        }
+
+        size += len;
+        if (
+            options.watch_max_size >= 0 &&
+            size > (size_t) options.watch_max_size
+        ) {
+            trace("filter", "reason=size size=%zu", size);
+            goto skip;
+        }
+        hash = hash_update(hash, buffer, len);
+        if (prefix != NULL && prefix_length < WATCH_MATCH_LIMIT) {
+            size_t count = WATCH_MATCH_LIMIT - prefix_length;
+            if (count > (size_t) len) {
+                count = len;
+            }
+            memcpy(prefix + prefix_length, buffer, count);
+            prefix_length += count;
+            /* Once we have enough, decide right away */
+            if (
+                prefix_length == WATCH_MATCH_LIMIT &&
+                !prefix_matches_regex(prefix, prefix_length)
+            ) {
+                trace("filter", "reason=match");
+                goto skip;
+            }
+        }
+        if (!write_fully(fd, buffer, len)) {
+            perror("Failed to buffer data");
+            goto skip;
+        }
+    }
+    /* Shorter data hasn't been matched yet */
+    if (
+        prefix != NULL &&
+        prefix_length < WATCH_MATCH_LIMIT &&
+        !prefix_matches_regex(prefix, prefix_length)
+    ) {
+        trace("filter", "reason=match");
+        goto skip;
+    }
+    close(pipe_fd);
+    free(prefix);
+
+    if (lseek(fd, 0, SEEK_SET) < 0) {
+        perror("lseek");
+        close(fd);
+        return -1;
+    }
+    if (options.watch_memfd && !seal_file(fd)) {
+        /* Still useful, just not guaranteed to stay intact */
+        trace("seal", "failed");
+    }
+    if (!options.watch_dedup) {
+        return fd;
+    }
+
+    struct watched *state = watched_for(selection);
+    if (state->seen && state->hash == hash) {
+        trace("dedup", "hash=%016llx", (unsigned long long) hash);
+        close(fd);
+        return -1;
+    }
+    state->seen = 1;
+    state->hash = hash;
+    return fd;
+
+skip:
+    /* Closing the pipe early tells the source to stop sending */
+    close(pipe_fd);
+    close(fd);
+    free(prefix);
+    return -1;
+}
+
+/* In --watch-json mode, prints a line describing the selection,
+ * along with the size, hash, and possibly contents of the data
+ * read from fd, unless it's negative.
+ */
+static int print_json_event(
+    int fd,
+    atom_t mime_type,
+    const char *state,
+    const struct selection *selection
+) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    size_t size = 0;
+    uint64_t hash = HASH_INIT;
+    struct text_scanner scanner;
+    text_scanner_init(&scanner);
+    /* Only kept while it fits under the inline cap */
+    struct wl_array payload;
+    wl_array_init(&payload);
+
+    char buffer[64 * 1024];
+    while (fd >= 0) {
+        ssize_t len = read(fd, buffer, sizeof(buffer));
+        if (len < 0 && errno == EINTR) {
+            continue;
+        } else if (len < 0) {
+            perror("read");
+            close(fd);
+            wl_array_release(&payload);
+            return 0;
+        } else if (len == 0) {
+            break;
+        }
+        hash = hash_update(hash, buffer, len);
+        text_scanner_feed(&scanner, buffer, len);
+        size += len;
+        if (size <= (size_t) options.watch_json_inline) {
+            memcpy(wl_array_add(&payload, len), buffer, len);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    printf(
+        "{\"time\":%.3f,\"selection\":\"%s\",\"seat\":",
+        now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0,
+        selection->primary ? "primary" : "clipboard"
+    );
+    const char *seat_name = seat_name_of(selection);
+    if (seat_name != NULL) {
+        json_print_string(stdout, seat_name, strlen(seat_name));
+    } else {
+        printf("null");
+    }
+    printf(",\"state\":\"%s\",\"types\":[", state);
+    if (selection->offer != NULL) {
+        const char *separator = "";
+        offer_for_each_mime_type(selection->offer, offered) {
+            printf("%s", separator);
+            json_print_string(stdout, offered, strlen(offered));
+            separator = ",";
+        }
+    }
+    printf(
+        "],\"sensitive\":%s",
+        strcmp(state, "sensitive") == 0 ? "true" : "false"
+    );
+
+    if (fd >= 0) {
+        const char *type = atom_name(mime_type);
+        int is_text = text_scanner_finish(&scanner);
+        printf(",\"type\":");
+        json_print_string(stdout, type, strlen(type));
+        printf(
+            ",\"size\":%zu,\"hash\":\"%016llx\",\"text\":%s",
+            size,
+            (unsigned long long) hash,
+            is_text ? "true" : "false"
+        );
+        /* Only inline text, as JSON strings can't hold arbitrary bytes */
+        if (is_text && size <= (size_t) options.watch_json_inline) {
+            printf(",\"payload\":");
+            json_print_string(stdout, payload.data, payload.size);
+        }
+    }
+    printf("}\n");
+    wl_array_release(&payload);
+
+    if (fflush(stdout) != 0) {
+        perror("write");
+        return 0;
+    }
+    return 1;
+}
+
 static void complain_no_suitable_type(const struct types *types) {
-    if (types->any == NULL) {
+    if (types->any == ATOM_NONE) {
         /* Report this the same way as
          * there being no offer at all.
          */
@@ -245,7 +878,89 @@ static void complain_no_suitable_type(const struct types *types) {
     exit(1);
 }
 
-static void selection_callback(struct offer *offer, int primary) {
+static void handle_selection(struct selection selection);
+
+static void defer_selection(struct selection selection) {
+    /* Whatever we had pending is now superseded, so
+     * drop it without ever receiving its contents.
+     */
+    struct watched *state = watched_for(&selection);
+    if (state->pending && state->selection.offer != NULL) {
+        offer_destroy(state->selection.offer);
+    }
+    state->pending = 1;
+    state->selection = selection;
+    struct timespec *deadline = &state->deadline;
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += options.debounce / 1000;
+    deadline->tv_nsec += (options.debounce % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/* How long to wait for events before a pending
+ * selection is due, in milliseconds, or -1.
+ */
+static int pending_timeout_for(const struct watched *state) {
+    if (!state->pending) {
+        return -1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (state->deadline.tv_sec - now.tv_sec) * 1000
+        + (state->deadline.tv_nsec - now.tv_nsec) / 1000000;
+    if (ms <= 0) {
+        return 0;
+    }
+    /* Round up, so we don't wake up too early */
+    return ms + 1;
+}
+
+static int pending_timeout(void) {
+    int timeout = -1;
+    struct watched *state;
+    wl_array_for_each(state, &watched) {
+        int this_timeout = pending_timeout_for(state);
+        if (timeout < 0 || (this_timeout >= 0 && this_timeout < timeout)) {
+            timeout = this_timeout;
+        }
+    }
+    return timeout;
+}
+
+static void process_pending_selections(int dispatched) {
+    /* With --coalesce, wait until there are no
+     * more events to be handled right away. With
+     * --debounce, the deadline is all that counts.
+     */
+    if (options.coalesce && dispatched > 0) {
+        return;
+    }
+    /* Processing a selection might add more entries,
+     * so look at the array anew each time.
+     */
+    for (size_t i = 0; i < watched.size / sizeof(struct watched); i++) {
+        struct watched *state = (struct watched *) watched.data + i;
+        if (pending_timeout_for(state) != 0) {
+            continue;
+        }
+        state->pending = 0;
+        handle_selection(state->selection);
+    }
+}
+
+static int wants_selection(int primary) {
+    return options.both_selections || primary == options.primary;
+}
+
+static void selection_callback(
+    struct device *device,
+    struct offer *offer,
+    int primary
+) {
+    PROBE2(selection_callback, offer, primary);
     /* Ignore all but the first non-NULL offer.
      * This could happen due to reentrancy, though
      * we try to prevent it in other ways.
@@ -255,27 +970,115 @@ static void selection_callback(struct offer *offer, int primary) {
     }
 
     /* Ignore events we're not interested in */
-    if (primary != options.primary) {
+    if (!wants_selection(primary)) {
         if (offer != NULL) {
             offer_destroy(offer);
         };
         return;
     }
 
+    struct selection selection = {
+        .offer = offer,
+        .primary = primary,
+        .seat = device->data
+    };
+    if (options.watch && (options.debounce > 0 || options.coalesce)) {
+        defer_selection(selection);
+        return;
+    }
+    handle_selection(selection);
+}
+
+static void drop_queued(struct queued item) {
+    close(item.fd);
+    if (item.selection.offer != NULL) {
+        offer_destroy(item.selection.offer);
+    }
+}
+
+static void enqueue(struct queued item) {
+    size_t count = watch_queue.size / sizeof(struct queued);
+    struct queued *queue = watch_queue.data;
+    if (options.watch_queue_policy == WATCH_QUEUE_LATEST) {
+        for (size_t i = 0; i < count; i++) {
+            drop_queued(queue[i]);
+        }
+        watch_queue.size = 0;
+    } else if (count >= WATCH_QUEUE_LIMIT) {
+        if (options.watch_queue_policy == WATCH_QUEUE_ALL) {
+            drop_queued(item);
+            return;
+        }
+        drop_queued(queue[0]);
+        memmove(queue, queue + 1, (count - 1) * sizeof(struct queued));
+        watch_queue.size -= sizeof(struct queued);
+    }
+    struct queued *ptr = wl_array_add(&watch_queue, sizeof(struct queued));
+    *ptr = item;
+}
+
+static void start_jobs() {
+    while (running_jobs < options.watch_jobs && watch_queue.size > 0) {
+        struct queued *queue = watch_queue.data;
+        struct queued item = queue[0];
+        size_t count = watch_queue.size / sizeof(struct queued);
+        memmove(queue, queue + 1, (count - 1) * sizeof(struct queued));
+        watch_queue.size -= sizeof(struct queued);
+        start_job(item.fd, item.state, item.selection);
+    }
+}
+
+/* Starts a job for the selection, or if all the jobs
+ * are busy, queues it up. This takes ownership of
+ * the fd and the offer.
+ */
+static void hand_off(int fd, const char *state, struct selection selection) {
+    if (running_jobs < options.watch_jobs) {
+        start_job(fd, state, selection);
+        return;
+    }
+    struct queued item = {
+        .selection = selection,
+        .fd = fd,
+        .state = state
+    };
+    enqueue(item);
+}
+
+static void handle_selection(struct selection selection) {
+    struct offer *offer = selection.offer;
     if (offer == NULL) {
         if (!options.watch) {
             bail("Nothing is copied");
         }
+        /* Copying the same data again is a change after all */
+        watched_for(&selection)->seen = 0;
+        if (options.watch_json) {
+            print_json_event(-1, ATOM_NONE, "nil", &selection);
+            return;
+        }
+        if (watch_sink != NULL) {
+            watch_sink_write(
+                watch_sink,
+                -1,
+                0,
+                NULL,
+                "nil",
+                seat_name_of(&selection)
+            );
+            return;
+        }
         int devnull = open("/dev/null", O_RDONLY | O_CLOEXEC);
         if (devnull < 0) {
             perror("open /dev/null");
             return;
         }
-        run_paste_command(devnull, "nil");
+        hand_off(devnull, "nil", selection);
         return;
     }
 
     offer_received = 1;
+    trace("selection", "types=%zu", offer_get_mime_type_count(offer));
 
     if (options.list_types) {
         offer_for_each_mime_type(offer, mime_type) {
@@ -284,10 +1087,52 @@ static void selection_callback(struct offer *offer, int primary) {
         exit(0);
     }
 
+    if (!offer_passes_type_filter(offer)) {
+        trace("filter", "reason=type");
+        offer_destroy(offer);
+        return;
+    }
+
     struct types types = classify_offer_types(offer);
-    const char *mime_type = mime_type_to_request(types);
+    const char *clipboard_state = "data";
+    if (types.has_sensitive_hint) {
+        clipboard_state = "sensitive";
+    }
+
+    if (options.watch && options.watch_no_data) {
+        /* Don't transfer anything, the command can
+         * look at CLIPBOARD_TYPES if it wants to.
+         */
+        if (options.watch_json) {
+            print_json_event(-1, ATOM_NONE, clipboard_state, &selection);
+            offer_destroy(offer);
+            return;
+        }
+        if (watch_sink != NULL) {
+            watch_sink_write(
+                watch_sink,
+                -1,
+                0,
+                NULL,
+                clipboard_state,
+                seat_name_of(&selection)
+            );
+            offer_destroy(offer);
+            return;
+        }
+        int devnull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (devnull < 0) {
+            perror("open /dev/null");
+            offer_destroy(offer);
+            return;
+        }
+        hand_off(devnull, clipboard_state, selection);
+        return;
+    }
+
+    atom_t mime_type = mime_type_to_request(types);
 
-    if (mime_type == NULL) {
+    if (mime_type == ATOM_NONE) {
         if (options.watch) {
             offer_destroy(offer);
             return;
@@ -296,7 +1141,7 @@ static void selection_callback(struct offer *offer, int primary) {
     }
 
     /* Never append a newline character to binary content */
-    if (!mime_type_is_text(mime_type)) {
+    if (!atom_is_text(mime_type)) {
         options.no_newline = 1;
     }
 
@@ -313,8 +1158,14 @@ static void selection_callback(struct offer *offer, int primary) {
         }
         exit(1);
     }
+    /* Don't leak the pipe into the commands we spawn
+     * for other selections, which would keep it open.
+     */
+    fcntl(pipefd[0], F_SETFD, FD_CLOEXEC);
+    fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
 
-    offer_receive(offer, mime_type, pipefd[1]);
+    offer_receive(offer, atom_name(mime_type), pipefd[1]);
+    trace("receive", "type=%s", atom_name(mime_type));
 
     if (popup_surface != NULL) {
         popup_surface_destroy(popup_surface);
@@ -328,11 +1179,26 @@ static void selection_callback(struct offer *offer, int primary) {
     wl_display_flush(wl_display);
 
     close(pipefd[1]);
-    const char *clipboard_state = "data";
-    if (types.has_sensitive_hint) {
-        clipboard_state = "sensitive";
+    int fd = pipefd[0];
+    if (need_to_inspect_data()) {
+        fd = receive_and_inspect(fd, mime_type, &selection);
+        if (fd < 0) {
+            offer_destroy(offer);
+            return;
+        }
     }
-    rc = run_paste_command(pipefd[0], clipboard_state);
+    if (options.watch_json) {
+        rc = print_json_event(fd, mime_type, clipboard_state, &selection);
+    } else if (watch_sink != NULL) {
+        rc = write_to_sink(fd, mime_type, clipboard_state, &selection);
+    } else if (options.watch) {
+        /* The job takes care of the offer */
+        hand_off(fd, clipboard_state, selection);
+        return;
+    } else {
+        rc = run_paste_command(fd, clipboard_state, &selection);
+    }
+    trace("received", "type=%s", atom_name(mime_type));
     if (!rc) {
         if (options.watch) {
             /* Try to cope without exiting completely */
@@ -358,6 +1224,55 @@ static void selection_callback(struct offer *offer, int primary) {
     }
 }
 
+/* Handles the \n, \t, \0 and \\ escapes in place,
+ * returning the resulting length.
+ */
+static size_t unescape(char *str) {
+    char *out = str;
+    for (const char *in = str; *in != 0; in++) {
+        if (*in != '\\' || in[1] == 0) {
+            *out++ = *in;
+            continue;
+        }
+        in++;
+        switch (*in) {
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case '0':
+            *out++ = 0;
+            break;
+        default:
+            *out++ = *in;
+            break;
+        }
+    }
+    return out - str;
+}
+
+static void set_up_watch_sink(void) {
+    if (options.watch_sink_init == NULL) {
+        return;
+    }
+    watch_sink = calloc(1, sizeof(struct watch_sink));
+    watch_sink->path = options.watch_sink_path;
+    watch_sink->argv = options.watch_command;
+    if (options.watch_separator != NULL) {
+        watch_sink->separator = options.watch_separator;
+        watch_sink->separator_length = unescape(options.watch_separator);
+    } else {
+        watch_sink->separator = "\n";
+        watch_sink->separator_length = 1;
+    }
+    options.watch_sink_init(watch_sink);
+
+    /* Don't get killed if the other side goes away */
+    signal(SIGPIPE, SIG_IGN);
+}
+
 static void print_usage(FILE *f, const char *argv0) {
     fprintf(
         f,
@@ -368,12 +1283,47 @@ static void print_usage(FILE *f, const char *argv0) {
         "\t-n, --no-newline\tDo not append a newline character.\n"
         "\t-l, --list-types\tInstead of pasting, list the offered types.\n"
         "\t-p, --primary\t\tUse the \"primary\" clipboard.\n"
+        "\t    --selection name\t"
+        "Use clipboard, primary, or both (for watch mode).\n"
         "\t-w, --watch command\t"
         "Run a command each time the selection changes.\n"
+        "\t    --watch-append file\t"
+        "Append the selection to a file each time it changes.\n"
+        "\t    --watch-separator separator\n"
+        "\t\t\t\tSeparate selections appended to a file with this.\n"
+        "\t    --watch-socket path\t"
+        "Write framed selections to a socket or a FIFO.\n"
+        "\t    --watch-coproc command\n"
+        "\t\t\t\tWrite framed selections to a single command.\n"
+        "\t    --watch-json\t"
+        "Print a JSON line describing each selection.\n"
+        "\t    --watch-json-inline bytes\n"
+        "\t\t\t\tInclude text up to this size in the JSON lines.\n"
+        "\t    --watch-no-data\t"
+        "Don't pass the contents to the watch command.\n"
+        "\t    --watch-memfd\t"
+        "Pass the contents as a sealed, seekable file.\n"
+        "\t    --watch-dedup\t"
+        "Skip selections with the same data as the last one.\n"
+        "\t    --watch-if-type glob\t"
+        "Only handle selections offered in a matching type.\n"
+        "\t    --watch-if-match regex\n"
+        "\t\t\t\tOnly handle selections whose data matches.\n"
+        "\t    --watch-max-size bytes\n"
+        "\t\t\t\tSkip selections larger than this.\n"
+        "\t    --watch-jobs count\t"
+        "Run up to this many commands at once.\n"
+        "\t    --watch-queue policy\n"
+        "\t\t\t\tWhat to do with selections while commands run.\n"
+        "\t    --debounce ms\t"
+        "Only handle selections that persist for this long.\n"
+        "\t    --coalesce\t\t"
+        "Skip selections that are immediately replaced.\n"
         "\t-t, --type mime/type\t"
         "Override the inferred MIME type for the content.\n"
         "\t-s, --seat seat-name\t"
-        "Pick the seat to work with.\n"
+        "Pick the seat to work with (* for all).\n"
+        "\t    --trace\t\tPrint timing info about each phase.\n"
         "\t-v, --version\t\tDisplay version info.\n"
         "\t-h, --help\t\tDisplay this message.\n"
         "Mandatory arguments to long options are mandatory"
@@ -383,6 +1333,35 @@ static void print_usage(FILE *f, const char *argv0) {
     );
 }
 
+/* Returns -1 if the string is not a non-negative number */
+static int parse_number(const char *str) {
+    char *end;
+    long number = strtol(str, &end, 10);
+    if (str[0] == 0 || *end != 0 || number < 0) {
+        return -1;
+    }
+    return number > INT_MAX ? INT_MAX : number;
+}
+
+static void add_watch_type_pattern(char *pattern) {
+    char **ptr = wl_array_add(&options.watch_type_patterns, sizeof(char *));
+    *ptr = pattern;
+}
+
+/* Selections can only go to one place, so only one of
+ * --watch, --watch-append, --watch-socket, --watch-coproc
+ * and --watch-json may be given.
+ */
+static void claim_watch_destination(const char *option, const char *argv0) {
+    static const char *claimed_by = NULL;
+    if (claimed_by != NULL) {
+        fprintf(stderr, "%s can't be combined with %s\n", option, claimed_by);
+        print_usage(stderr, argv0);
+        exit(1);
+    }
+    claimed_by = option;
+}
+
 static void parse_options(int argc, argv_t argv) {
     if (argc < 1) {
         bail("Empty argv");
@@ -392,13 +1371,33 @@ static void parse_options(int argc, argv_t argv) {
         {"version", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {"primary", no_argument, 0, 'p'},
+        {"selection", required_argument, 0, 'P'},
         {"no-newline", no_argument, 0, 'n'},
         {"list-types", no_argument, 0, 'l'},
         {"watch", required_argument, 0, 'w'},
+        {"watch-coproc", required_argument, 0, 'C'},
+        {"watch-append", required_argument, 0, 'A'},
+        {"watch-socket", required_argument, 0, 'K'},
+        {"watch-separator", required_argument, 0, 'E'},
+        {"debounce", required_argument, 0, 'D'},
+        {"watch-jobs", required_argument, 0, 'J'},
+        {"watch-no-data", no_argument, 0, 'N'},
+        {"watch-json", no_argument, 0, 'W'},
+        {"watch-json-inline", required_argument, 0, 'I'},
+        {"watch-dedup", no_argument, 0, 'U'},
+        {"watch-memfd", no_argument, 0, 'F'},
+        {"watch-if-type", required_argument, 0, 'Y'},
+        {"watch-if-match", required_argument, 0, 'M'},
+        {"watch-max-size", required_argument, 0, 'Z'},
+        {"watch-queue", required_argument, 0, 'Q'},
+        {"coalesce", no_argument, 0, 'O'},
         {"type", required_argument, 0, 't'},
         {"seat", required_argument, 0, 's'},
+        {"trace", no_argument, 0, 'T'},
         {0, 0, 0, 0}
     };
+    /* The last option we've seen that only makes sense in watch mode */
+    const char *watch_only = NULL;
     while (1) {
         int option_index;
         const char *opts = "vhpnlw:t:s:";
@@ -419,14 +1418,145 @@ static void parse_options(int argc, argv_t argv) {
         case 'p':
             options.primary = 1;
             break;
+        case 'P':
+            options.primary = 0;
+            options.both_selections = 0;
+            if (strcmp(optarg, "primary") == 0) {
+                options.primary = 1;
+            } else if (strcmp(optarg, "both") == 0) {
+                options.both_selections = 1;
+            } else if (strcmp(optarg, "clipboard") != 0) {
+                fprintf(stderr, "Unknown selection: %s\n", optarg);
+                print_usage(stderr, argv[0]);
+                exit(1);
+            }
+            break;
         case 'n':
             options.no_newline = 1;
             break;
         case 'l':
             options.list_types = 1;
             break;
+        case 'A':
+            claim_watch_destination("--watch-append", argv[0]);
+            options.watch = 1;
+            options.watch_sink_init = watch_sink_init_append;
+            options.watch_sink_path = optarg;
+            break;
+        case 'K':
+            claim_watch_destination("--watch-socket", argv[0]);
+            options.watch = 1;
+            options.watch_sink_init = watch_sink_init_socket;
+            options.watch_sink_path = optarg;
+            break;
+        case 'W':
+            claim_watch_destination("--watch-json", argv[0]);
+            options.watch = 1;
+            options.watch_json = 1;
+            options.watch_sink_init = NULL;
+            break;
+        case 'I':
+            watch_only = long_options[option_index].name;
+            options.watch_json_inline = parse_number(optarg);
+            if (options.watch_json_inline < 0) {
+                fprintf(stderr, "Invalid inline size: %s\n", optarg);
+                print_usage(stderr, argv[0]);
+                exit(1);
+            }
+            break;
+        case 'F':
+            watch_only = long_options[option_index].name;
+            options.watch_memfd = 1;
+            break;
+        case 'U':
+            watch_only = long_options[option_index].name;
+            options.watch_dedup = 1;
+            break;
+        case 'Y':
+            watch_only = long_options[option_index].name;
+            add_watch_type_pattern(optarg);
+            break;
+        case 'M':
+            watch_only = long_options[option_index].name;
+            if (options.watch_has_regex) {
+                regfree(&options.watch_regex);
+            }
+            if (regcomp(
+                &options.watch_regex,
+                optarg,
+                REG_EXTENDED | REG_NOSUB
+            ) != 0) {
+                fprintf(stderr, "Invalid regular expression: %s\n", optarg);
+                print_usage(stderr, argv[0]);
+                exit(1);
+            }
+            options.watch_has_regex = 1;
+            break;
+        case 'Z':
+            watch_only = long_options[option_index].name;
+            options.watch_max_size = parse_number(optarg);
+            if (options.watch_max_size < 0) {
+                fprintf(stderr, "Invalid size: %s\n", optarg);
+                print_usage(stderr, argv[0]);
+                exit(1);
+            }
+            break;
+        case 'E':
+            watch_only = long_options[option_index].name;
+            options.watch_separator = strdup(optarg);
+            break;
+        case 'D':
+            watch_only = long_options[option_index].name;
+            options.debounce = parse_number(optarg);
+            if (options.debounce < 0) {
+                fprintf(stderr, "Invalid debounce interval: %s\n", optarg);
+                print_usage(stderr, argv[0]);
+                exit(1);
+            }
+            break;
+        case 'O':
+            watch_only = long_options[option_index].name;
+            options.coalesce = 1;
+            break;
+        case 'N':
+            watch_only = long_options[option_index].name;
+            options.watch_no_data = 1;
+            break;
+        case 'J':
+            watch_only = long_options[option_index].name;
+            options.watch_jobs = parse_number(optarg);
+            if (options.watch_jobs < 1) {
+                fprintf(stderr, "Invalid number of jobs: %s\n", optarg);
+                print_usage(stderr, argv[0]);
+                exit(1);
+            }
+            break;
+        case 'Q':
+            watch_only = long_options[option_index].name;
+            if (strcmp(optarg, "queue") == 0) {
+                options.watch_queue_policy = WATCH_QUEUE_ALL;
+            } else if (strcmp(optarg, "drop-oldest") == 0) {
+                options.watch_queue_policy = WATCH_QUEUE_DROP_OLDEST;
+            } else if (strcmp(optarg, "latest") == 0) {
+                options.watch_queue_policy = WATCH_QUEUE_LATEST;
+            } else {
+                fprintf(stderr, "Unknown queue policy: %s\n", optarg);
+                print_usage(stderr, argv[0]);
+                exit(1);
+            }
+            break;
+        case 'C':
+            /* Same as --watch, except for where the data goes */
         case 'w':
+            claim_watch_destination(
+                c == 'C' ? "--watch-coproc" : "--watch",
+                argv[0]
+            );
             options.watch = 1;
+            options.watch_sink_init = NULL;
+            if (c == 'C') {
+                options.watch_sink_init = watch_sink_init_coprocess;
+            }
             /* We tell getopt that --watch requires an argument,
              * but it's more nuanced than that. We actually take
              * that argument and everything that follows it as a
@@ -450,7 +1580,8 @@ static void parse_options(int argc, argv_t argv) {
                 fprintf(
                     stderr,
                     "Expected a subcommand instead of an argument"
-                    " after --watch\n"
+                    " after %s\n",
+                    c == 'C' ? "--watch-coproc" : "--watch"
                 );
                 print_usage(stderr, argv[0]);
                 exit(1);
@@ -466,6 +1597,9 @@ static void parse_options(int argc, argv_t argv) {
         case 's':
             options.seat_name = strdup(optarg);
             break;
+        case 'T':
+            options.trace = 1;
+            break;
         default:
             /* getopt has already printed an error message */
             print_usage(stderr, argv[0]);
@@ -473,6 +1607,18 @@ static void parse_options(int argc, argv_t argv) {
         }
     }
 
+    if (watch_only != NULL && !options.watch) {
+        fprintf(stderr, "--%s only works in watch mode\n", watch_only);
+        print_usage(stderr, argv[0]);
+        exit(1);
+    }
+
+    if (options.both_selections && !options.watch) {
+        fprintf(stderr, "--selection both only works in watch mode\n");
+        print_usage(stderr, argv[0]);
+        exit(1);
+    }
+
     if (optind != argc) {
         fprintf(stderr, "Unexpected argument: %s\n", argv[optind]);
         print_usage(stderr, argv[0]);
@@ -480,8 +1626,174 @@ static void parse_options(int argc, argv_t argv) {
     }
 }
 
+/* When watching both selections, we need a protocol
+ * that supports the primary one, and then also check
+ * that it supports the regular one.
+ */
+static int need_primary(void) {
+    return options.primary || options.both_selections;
+}
+
+/* The devices we have set up, as struct device * */
+static struct wl_array devices;
+
+static struct device *set_up_device(struct seat *seat) {
+    struct device *device = device_manager_get_device(device_manager, seat);
+    struct device **ptr = wl_array_add(&devices, sizeof(struct device *));
+    *ptr = device;
+    /* Set up the callback before checking whether the device
+     * actually supports the kind of selection we need, because
+     * checking for the support might roundtrip.
+     */
+    device->selection_callback = selection_callback;
+    device->data = seat;
+    trace("device", NULL);
+    return device;
+}
+
+/* Whether the device lets us get the selection
+ * we're interested in. This might roundtrip.
+ */
+static int device_is_usable(struct device *device) {
+    if (!device_supports_selection(device, need_primary())) {
+        return 0;
+    }
+    if (options.both_selections && !device_supports_selection(device, 0)) {
+        return 0;
+    }
+    /* We can't keep a popup surface focused all the time */
+    if (options.watch && device->needs_popup_surface) {
+        return 0;
+    }
+    trace("support-check", "primary=%d", need_primary());
+    return 1;
+}
+
+static void complain_about_unusable_device(struct device *device) {
+    if (!device_supports_selection(device, need_primary())) {
+        complain_about_selection_support(need_primary());
+    }
+    complain_about_watch_mode_support();
+}
+
+static void drop_selection_callback(
+    struct device *device,
+    struct offer *offer,
+    int primary
+) {
+    if (offer != NULL) {
+        offer_destroy(offer);
+    }
+}
+
+/* With --seat '*', seats that have appeared since we
+ * last looked, as struct seat *. We don't set them up
+ * right away, since that might roundtrip, and we get
+ * notified about them from inside an event handler.
+ */
+static struct wl_array new_seats;
+
+static void new_seat_callback(struct registry *registry, struct seat *seat) {
+    struct seat **ptr = wl_array_add(&new_seats, sizeof(struct seat *));
+    *ptr = seat;
+}
+
+/* With --seat '*', stops watching a seat that has gone
+ * away, and forgets everything we have about it.
+ */
+static void seat_removed_callback(
+    struct registry *registry,
+    struct seat *seat
+) {
+    for (size_t i = 0; i < devices.size / sizeof(struct device *);) {
+        struct device **ptr = (struct device **) devices.data + i;
+        if ((*ptr)->data != seat) {
+            i++;
+            continue;
+        }
+        device_destroy(*ptr);
+        devices.size -= sizeof(struct device *);
+        *ptr = *(struct device **) ((char *) devices.data + devices.size);
+    }
+
+    for (size_t i = 0; i < watched.size / sizeof(struct watched);) {
+        struct watched *state = (struct watched *) watched.data + i;
+        if (state->seat != seat) {
+            i++;
+            continue;
+        }
+        if (state->pending && state->selection.offer != NULL) {
+            offer_destroy(state->selection.offer);
+        }
+        watched.size -= sizeof(struct watched);
+        *state = *(struct watched *) ((char *) watched.data + watched.size);
+    }
+
+    /* The data has been received already, but there's nobody
+     * left to tell the commands about the seat. Keep the rest
+     * of the queue in order.
+     */
+    struct queued *queue = watch_queue.data;
+    size_t count = watch_queue.size / sizeof(struct queued);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (queue[i].selection.seat == seat) {
+            drop_queued(queue[i]);
+        } else {
+            queue[kept++] = queue[i];
+        }
+    }
+    watch_queue.size = kept * sizeof(struct queued);
+
+    struct seat **new_seat;
+    wl_array_for_each(new_seat, &new_seats) {
+        if (*new_seat == seat) {
+            new_seats.size -= sizeof(struct seat *);
+            *new_seat = *(struct seat **) (
+                (char *) new_seats.data + new_seats.size
+            );
+            break;
+        }
+    }
+
+    trace("seat-removed", "name=%s", seat->name != NULL ? seat->name : "?");
+    seat_destroy(seat);
+}
+
+static void set_up_new_seats(void) {
+    /* More seats might appear while we're at it */
+    while (new_seats.size > 0) {
+        new_seats.size -= sizeof(struct seat *);
+        struct seat *seat = *(struct seat **) (
+            (char *) new_seats.data + new_seats.size
+        );
+        struct device *device = set_up_device(seat);
+        if (!device_is_usable(device)) {
+            /* Don't give up on the seats we already watch */
+            fprintf(
+                stderr,
+                "Not watching seat %s, as it doesn't support the selection\n",
+                seat->name != NULL ? seat->name : "?"
+            );
+            device->selection_callback = drop_selection_callback;
+        }
+    }
+}
+
 int main(int argc, argv_t argv) {
+    options.watch_jobs = 1;
+    options.watch_max_size = -1;
     parse_options(argc, argv);
+    trace_init("wl-paste", options.trace);
+    set_up_watch_sink();
+    /* Selection events might come in as soon as we create
+     * a device, so get these ready before we do that.
+     */
+    wl_array_init(&watched);
+    wl_array_init(&watch_queue);
+    wl_array_init(&jobs);
+    wl_array_init(&new_seats);
+    wl_array_init(&devices);
 
     char *path = path_for_fd(STDOUT_FILENO);
     if (path != NULL && options.explicit_type == NULL) {
@@ -489,6 +1801,13 @@ int main(int argc, argv_t argv) {
     }
     free(path);
 
+    if (options.explicit_type != NULL) {
+        explicit_atom = atom_intern(options.explicit_type);
+    }
+    if (options.inferred_type != NULL) {
+        inferred_atom = atom_intern(options.inferred_type);
+    }
+
     wl_display = wl_display_connect(NULL);
     if (wl_display == NULL) {
         complain_about_wayland_connection();
@@ -496,41 +1815,67 @@ int main(int argc, argv_t argv) {
     if (wl_display_get_fd(wl_display) <= STDERR_FILENO) {
         complain_about_closed_stdio(wl_display);
     }
+    trace("connect", NULL);
+
+    event_loop.wl_display = wl_display;
+    event_loop_init(&event_loop);
 
     struct registry *registry = calloc(1, sizeof(struct registry));
     registry->wl_display = wl_display;
     registry_init(registry);
 
     /* Wait for the initial set of globals to appear */
+    PROBE(roundtrip_begin);
     wl_display_roundtrip(wl_display);
+    PROBE(roundtrip_end);
+    trace("globals", NULL);
 
-    struct seat *seat = registry_find_seat(registry, options.seat_name);
-    if (seat == NULL) {
-        complain_about_missing_seat(options.seat_name);
+    int all_seats = options.seat_name != NULL
+        && strcmp(options.seat_name, "*") == 0;
+    if (all_seats && !options.watch) {
+        bail("--seat '*' only works in watch mode");
     }
 
-    /* Create the device */
-    struct device_manager *device_manager
-        = registry_find_device_manager(registry, options.primary);
-    if (device_manager == NULL) {
-        complain_about_selection_support(options.primary);
+    struct seat *seat = NULL;
+    if (!all_seats) {
+        seat = registry_find_seat(registry, options.seat_name);
+        if (seat == NULL) {
+            complain_about_missing_seat(options.seat_name);
+        }
+        trace("seat", "name=%s", seat->name != NULL ? seat->name : "?");
     }
 
-    struct device *device = device_manager_get_device(device_manager, seat);
-    /* Set up the callback before checking whether the device
-     * actually supports the kind of selection we need, because
-     * checking for the support might roundtrip.
-     */
-    device->selection_callback = selection_callback;
+    device_manager = registry_find_device_manager(registry, need_primary());
+    if (device_manager == NULL) {
+        complain_about_selection_support(need_primary());
+    }
+    trace_set_backend(device_manager->name);
 
-    if (!device_supports_selection(device, options.primary)) {
-        complain_about_selection_support(options.primary);
+    if (all_seats) {
+        /* Watch all the seats, including the ones that appear
+         * later. Setting up a device might roundtrip, and more
+         * seats might appear in the meantime, so make sure to
+         * look at the array anew each time.
+         */
+        for (size_t i = 0; i < registry->seats.size / sizeof(seat); i++) {
+            struct seat **seats = registry->seats.data;
+            struct device *device = set_up_device(seats[i]);
+            if (!device_is_usable(device)) {
+                complain_about_unusable_device(device);
+            }
+        }
+        registry->new_seat_callback = new_seat_callback;
+        registry->seat_removed_callback = seat_removed_callback;
     }
 
-    if (device->needs_popup_surface) {
-        if (options.watch) {
-            complain_about_watch_mode_support();
+    struct device *device = NULL;
+    if (seat != NULL) {
+        device = set_up_device(seat);
+        if (!device_is_usable(device)) {
+            complain_about_unusable_device(device);
         }
+    }
+    if (device != NULL && device->needs_popup_surface) {
         /* If we cannot get the selection directly, pop up
          * a surface. When it gets focus, we'll immediately
          * get the selection events, se we don't need to do
@@ -542,7 +1887,14 @@ int main(int argc, argv_t argv) {
         popup_surface_init(popup_surface);
     }
 
-    while (wl_display_dispatch(wl_display) >= 0);
+    while (1) {
+        int dispatched = event_loop_dispatch(&event_loop, pending_timeout());
+        if (dispatched < 0) {
+            break;
+        }
+        process_pending_selections(dispatched);
+        set_up_new_seats();
+    }
 
     perror("wl_display_dispatch");
     return 1;
@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+
+# wl-clipboard
+#
+# Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Measures how long it takes to copy data with wl-copy and paste it back
+# with wl-paste, against the compositor in $WAYLAND_DISPLAY, such as a
+# headless sway or weston. Without one, the benchmark is skipped.
+#
+# Usage: benchmark-throughput.py wl-copy wl-paste [options]
+#
+# For each backend (see WL_CLIPBOARD_BACKEND), payload kind (text or
+# binary), way of passing stdin to wl-copy (a file or a pipe) and size, it
+# runs wl-copy and then a number of concurrent wl-paste readers, and
+# records:
+# - copy_ms, from spawning wl-copy to it having set the selection, which
+#   is when it forks into the background and the parent exits;
+# - first_byte_ms and paste_ms, from spawning wl-paste to it delivering
+#   the first byte and all of the data;
+# - the throughput of the readers, their peak RSS and CPU time, and with
+#   --strace, the number of syscalls they make.
+# The pasted data is checked against what was copied. The results are
+# written to the output file as JSON.
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import zlib
+
+# The exit code meson treats as a skipped test
+SKIP = 77
+
+BACKENDS = ['ext', 'wlr', 'core', 'wp', 'gtk']
+CHUNK_SIZE = 1024 * 1024
+
+
+def parse_size(text):
+    units = {'K': 1 << 10, 'M': 1 << 20, 'G': 1 << 30}
+    if text and text[-1].upper() in units:
+        return int(text[:-1]) * units[text[-1].upper()]
+    return int(text)
+
+
+def sizes_up_to(max_size):
+    # 16 B, 256 B, 4 KiB, ... 4 GiB
+    size = 16
+    while size <= max_size:
+        yield size
+        size *= 16
+
+
+def make_payload(directory, kind, size):
+    # Returns the path and the checksum of the payload.
+    # Binary payloads repeat a random block, which is
+    # enough to defeat any text detection.
+    if kind == 'text':
+        line = b'The quick brown fox jumps over the lazy dog.\n'
+        block = line * (CHUNK_SIZE // len(line) + 1)
+    else:
+        block = os.urandom(CHUNK_SIZE)
+    path = os.path.join(directory, '{}-{}'.format(kind, size))
+    crc = 0
+    with open(path, 'wb') as f:
+        left = size
+        while left > 0:
+            chunk = block[:min(left, len(block))]
+            f.write(chunk)
+            crc = zlib.crc32(chunk, crc)
+            left -= len(chunk)
+    return path, crc
+
+
+def percentile(values, p):
+    values = sorted(values)
+    if not values:
+        return None
+    index = min(len(values) - 1, int(round(p / 100 * (len(values) - 1))))
+    return values[index]
+
+
+def count_syscalls(strace_output):
+    # The last line of strace -c looks like:
+    # 100.00    0.002000           7       270        18 total
+    with open(strace_output) as f:
+        for line in f:
+            words = line.split()
+            if words and words[-1] == 'total':
+                return int(words[3])
+    return None
+
+
+class Reader:
+    def __init__(self, args, env, directory, index):
+        self.strace_output = None
+        command = [args.wl_paste, '--no-newline']
+        if args.strace:
+            self.strace_output = os.path.join(
+                directory, 'strace-{}'.format(index)
+            )
+            command = [
+                'strace', '-c', '-f', '-o', self.strace_output
+            ] + command
+        self.timeout = args.timeout
+        self.start = time.monotonic()
+        self.process = subprocess.Popen(
+            command,
+            env=env,
+            stdout=subprocess.PIPE
+        )
+        self.first_byte = None
+        self.size = 0
+        self.crc = 0
+        self.thread = threading.Thread(target=self.read)
+        self.thread.start()
+
+    def read(self):
+        while True:
+            chunk = self.process.stdout.read1(CHUNK_SIZE)
+            if not chunk:
+                break
+            if self.first_byte is None:
+                self.first_byte = time.monotonic()
+            self.size += len(chunk)
+            self.crc = zlib.crc32(chunk, self.crc)
+        self.end = time.monotonic()
+
+    def finish(self):
+        self.thread.join(self.timeout)
+        if self.thread.is_alive():
+            self.process.kill()
+            self.thread.join()
+            raise RuntimeError('wl-paste timed out')
+        # Unlike Popen.wait(), this gets us the resource usage
+        _, status, usage = os.wait4(self.process.pid, 0)
+        self.process.returncode = status
+        if status != 0:
+            raise RuntimeError('wl-paste failed')
+        syscalls = None
+        if self.strace_output is not None:
+            syscalls = count_syscalls(self.strace_output)
+        return {
+            'first_byte_ms': ((self.first_byte or self.end) - self.start)
+            * 1e3,
+            'paste_ms': (self.end - self.start) * 1e3,
+            'max_rss_kb': usage.ru_maxrss,
+            'cpu_ms': (usage.ru_utime + usage.ru_stime) * 1e3,
+            'syscalls': syscalls,
+            'size': self.size,
+            'crc': self.crc,
+        }
+
+
+def run_once(args, env, directory, path, crc, size, stdin_mode):
+    start = time.monotonic()
+    with open(path, 'rb') as f:
+        if stdin_mode == 'file':
+            copy = subprocess.Popen([args.wl_copy], env=env, stdin=f)
+            feeder = None
+        else:
+            feeder = subprocess.Popen(['cat'], stdin=f, stdout=subprocess.PIPE)
+            copy = subprocess.Popen(
+                [args.wl_copy],
+                env=env,
+                stdin=feeder.stdout
+            )
+            feeder.stdout.close()
+        try:
+            status = copy.wait(args.timeout)
+        except subprocess.TimeoutExpired:
+            copy.kill()
+            raise RuntimeError('wl-copy timed out')
+        if feeder is not None:
+            feeder.wait()
+    if status != 0:
+        raise RuntimeError('wl-copy failed')
+    copy_ms = (time.monotonic() - start) * 1e3
+
+    readers = [
+        Reader(args, env, directory, i) for i in range(args.readers)
+    ]
+    results = [reader.finish() for reader in readers]
+    for result in results:
+        if result['size'] != size or result['crc'] != crc:
+            raise RuntimeError('pasted data differs from copied data')
+    return copy_ms, results
+
+
+def summarize(values):
+    return {
+        'p50': percentile(values, 50),
+        'p99': percentile(values, 99),
+    }
+
+
+def benchmark(args, env, directory, path, crc, size, stdin_mode):
+    copy_times = []
+    results = []
+    for _ in range(args.runs):
+        copy_ms, run_results = run_once(
+            args, env, directory, path, crc, size, stdin_mode
+        )
+        copy_times.append(copy_ms)
+        results += run_results
+    # Make the background wl-copy exit
+    subprocess.run([args.wl_copy, '--clear'], env=env, timeout=args.timeout)
+
+    paste_times = [r['paste_ms'] for r in results]
+    median = percentile(paste_times, 50)
+    syscalls = [r['syscalls'] for r in results if r['syscalls'] is not None]
+    return {
+        'copy_ms': summarize(copy_times),
+        'first_byte_ms': summarize([r['first_byte_ms'] for r in results]),
+        'paste_ms': summarize(paste_times),
+        'mb_per_s': size / 1e6 / (median / 1e3) if median else None,
+        'max_rss_kb': max(r['max_rss_kb'] for r in results),
+        'cpu_ms': summarize([r['cpu_ms'] for r in results]),
+        'syscalls': percentile(syscalls, 50),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('wl_copy')
+    parser.add_argument('wl_paste')
+    parser.add_argument('--output', default='throughput.json')
+    parser.add_argument('--max-size', type=parse_size, default='256M')
+    parser.add_argument('--runs', type=int, default=5)
+    parser.add_argument('--readers', type=int, default=1)
+    parser.add_argument('--backends', default='',
+        help='comma-separated, defaults to letting wl-clipboard pick')
+    parser.add_argument('--kinds', default='text,binary')
+    parser.add_argument('--stdin', default='file,pipe')
+    parser.add_argument('--strace', action='store_true')
+    parser.add_argument('--timeout', type=float, default=60)
+    args = parser.parse_args()
+
+    if not os.environ.get('WAYLAND_DISPLAY'):
+        print('WAYLAND_DISPLAY is not set, skipping', file=sys.stderr)
+        sys.exit(SKIP)
+
+    backends = [b for b in args.backends.split(',') if b] or ['']
+    for backend in backends:
+        if backend and backend not in BACKENDS:
+            parser.error('unknown backend: ' + backend)
+
+    entries = []
+    with tempfile.TemporaryDirectory() as directory:
+        for kind in args.kinds.split(','):
+            for size in sizes_up_to(args.max_size):
+                path, crc = make_payload(directory, kind, size)
+                for backend in backends:
+                    env = dict(os.environ)
+                    env['WL_CLIPBOARD_BACKEND'] = backend
+                    for stdin_mode in args.stdin.split(','):
+                        entry = {
+                            'backend': backend or 'default',
+                            'kind': kind,
+                            'stdin': stdin_mode,
+                            'size': size,
+                            'readers': args.readers,
+                            'runs': args.runs,
+                        }
+                        try:
+                            entry.update(benchmark(
+                                args, env, directory,
+                                path, crc, size, stdin_mode
+                            ))
+                        except (RuntimeError, OSError,
+                                subprocess.TimeoutExpired) as e:
+                            entry['error'] = str(e)
+                        print(json.dumps(entry), file=sys.stderr)
+                        entries.append(entry)
+                os.unlink(path)
+
+    with open(args.output, 'w') as f:
+        json.dump({'results': entries}, f, indent=2)
+        f.write('\n')
+
+
+if __name__ == '__main__':
+    main()
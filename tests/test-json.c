@@ -0,0 +1,63 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "test.h"
+
+#include "util/json.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static char buffer[256];
+
+static const char *to_json(const char *data, size_t length) {
+    FILE *f = fmemopen(buffer, sizeof(buffer), "w");
+    check(f != NULL);
+    json_print_string(f, data, length);
+    check(fclose(f) == 0);
+    return buffer;
+}
+
+#define check_json(str, expected) \
+    check(strcmp(to_json(str, sizeof(str) - 1), expected) == 0)
+
+int main(void) {
+    check_json("", "\"\"");
+    check_json("plain", "\"plain\"");
+    check_json("say \"hi\"", "\"say \\\"hi\\\"\"");
+    check_json("back\\slash", "\"back\\\\slash\"");
+    check_json("a\nb\rc\td", "\"a\\nb\\rc\\td\"");
+    check_json("\x01\x1f\x7f", "\"\\u0001\\u001f\\u007f\"");
+    check_json("nul\0", "\"nul\\u0000\"");
+
+    /* Valid UTF-8 is kept as is */
+    check_json("caf\xc3\xa9", "\"caf\xc3\xa9\"");
+    check_json("\xf0\x9f\x98\x80", "\"\xf0\x9f\x98\x80\"");
+
+    /* Invalid bytes are replaced one at a time */
+    check_json("\xff", "\"\\ufffd\"");
+    check_json("a\x80z", "\"a\\ufffdz\"");
+    check_json("\xc0\xaf", "\"\\ufffd\\ufffd\"");
+    check_json("\xed\xa0\x80", "\"\\ufffd\\ufffd\\ufffd\"");
+    /* A sequence cut off by the end of the data */
+    check_json("\xe2\x82", "\"\\ufffd\\ufffd\"");
+    /* Or by another character */
+    check_json("\xe2\x82!", "\"\\ufffd\\ufffd!\"");
+    return 0;
+}
@@ -0,0 +1,123 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "test.h"
+
+#include "util/mime-cache.h"
+
+#include <string.h>
+#include <unistd.h>
+
+static char dir[] = "/tmp/wl-clipboard-test-XXXXXX";
+static char path[64];
+
+static void write_file(const char *name, const char *data, size_t length) {
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "w");
+    check(f != NULL);
+    check(fwrite(data, 1, length, f) == length);
+    check(fclose(f) == 0);
+}
+
+static char *key_for(const char *name) {
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    char *key = mime_cache_key_for_contents(path);
+    check(key != NULL);
+    return key;
+}
+
+static void test_keys(void) {
+    write_file("a", "same", 4);
+    write_file("b", "same", 4);
+    write_file("c", "diff", 4);
+    char *a = key_for("a");
+    char *b = key_for("b");
+    char *c = key_for("c");
+    check(strcmp(a, b) == 0);
+    check(strcmp(a, c) != 0);
+    free(a);
+    free(b);
+    free(c);
+
+    /* Contents that only differ past the beginning, as
+     * they can be text or binary depending on the tail.
+     */
+    size_t size = 256 * 1024;
+    char *data = malloc(size);
+    memset(data, 'x', size);
+    write_file("text", data, size);
+    data[size - 1] = 0;
+    write_file("binary", data, size);
+    free(data);
+    char *text = key_for("text");
+    char *binary = key_for("binary");
+    check(strcmp(text, binary) != 0);
+    free(text);
+    free(binary);
+}
+
+static void test_store(void) {
+    char *mime_type = NULL;
+    check(!mime_cache_lookup("key", &mime_type));
+
+    mime_cache_store("key", "text/plain");
+    check(mime_cache_lookup("key", &mime_type));
+    check(strcmp(mime_type, "text/plain") == 0);
+    free(mime_type);
+
+    /* Remembering that the type could not be inferred */
+    mime_cache_store("unknown", NULL);
+    mime_type = "";
+    check(mime_cache_lookup("unknown", &mime_type));
+    check(mime_type == NULL);
+
+    /* Types that would break the file format aren't stored */
+    mime_cache_store("weird", "text/plain\nkey\tinjected");
+    check(!mime_cache_lookup("weird", &mime_type));
+    check(!mime_cache_lookup("injected", &mime_type));
+
+    /* Storing the same key again replaces the type */
+    mime_cache_store("key", "image/png");
+    check(mime_cache_lookup("key", &mime_type));
+    check(strcmp(mime_type, "image/png") == 0);
+    free(mime_type);
+
+    /* Filling it up evicts the least recently used entries.
+     * Storing "key" again has made "unknown" the oldest one.
+     */
+    for (int i = 0; i < 63; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "filler%d", i);
+        mime_cache_store(key, "text/plain");
+    }
+    check(!mime_cache_lookup("unknown", &mime_type));
+    check(mime_cache_lookup("key", &mime_type));
+    free(mime_type);
+}
+
+int main(void) {
+    check(mkdtemp(dir) != NULL);
+    setenv("XDG_RUNTIME_DIR", dir, 1);
+    test_keys();
+    test_store();
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    check(system(command) == 0);
+    return 0;
+}
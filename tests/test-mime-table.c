@@ -0,0 +1,75 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "test.h"
+
+#include "util/mime-table.h"
+#include "util/string.h"
+
+#include <string.h>
+
+static const struct mime_table_entry *lookup(const char *name) {
+    return mime_table_lookup(name, strlen(name));
+}
+
+int main(void) {
+    const struct mime_table_entry *plain = lookup("text/plain");
+    if (plain == NULL) {
+        /* Built without shared-mime-info data */
+        check(lookup("image/png") == NULL);
+        return SKIP;
+    }
+    check(strcmp(plain->name, "text/plain") == 0);
+    check(plain->alias_of == NULL);
+    check(plain->is_text);
+
+    const struct mime_table_entry *png = lookup("image/png");
+    check(png != NULL);
+    check(!png->is_text);
+
+    /* Unknown types, and prefixes of known ones */
+    check(lookup("application/x-wl-clipboard-test") == NULL);
+    check(lookup("text/plai") == NULL);
+    check(lookup("") == NULL);
+
+    /* Only the given length is looked at, which lets
+     * callers skip parameters without copying.
+     */
+    const char *with_params = "text/plain;charset=utf-8";
+    check(mime_table_lookup(with_params, strcspn(with_params, ";"))
+        == plain);
+
+    /* MIME types are case-insensitive */
+    check(lookup("Text/Plain") == plain);
+    check(lookup("IMAGE/PNG") == png);
+
+    /* Subclasses of text/plain are text, and aliases
+     * resolve to what they are aliases of.
+     */
+    check(mime_type_is_text("application/x-shellscript"));
+    const struct mime_table_entry *alias = lookup("application/x-javascript");
+    if (alias != NULL && alias->alias_of != NULL) {
+        check(lookup(alias->alias_of) != NULL);
+        check(mime_type_is_text("application/x-javascript")
+            == lookup(alias->alias_of)->is_text);
+    }
+    check(!mime_type_is_text("image/png"));
+    check(!mime_type_is_text("Image/PNG"));
+    return 0;
+}
@@ -0,0 +1,86 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "test.h"
+
+#include "util/text.h"
+
+#include <string.h>
+
+static int looks_like_text(const char *data, size_t length) {
+    struct text_scanner scanner;
+    text_scanner_init(&scanner);
+    text_scanner_feed(&scanner, data, length);
+    return text_scanner_finish(&scanner);
+}
+
+/* Feeds the data one byte at a time, to make sure the
+ * result doesn't depend on where the chunks are split.
+ */
+static int looks_like_text_bytewise(const char *data, size_t length) {
+    struct text_scanner scanner;
+    text_scanner_init(&scanner);
+    for (size_t i = 0; i < length; i++) {
+        text_scanner_feed(&scanner, data + i, 1);
+    }
+    return text_scanner_finish(&scanner);
+}
+
+#define check_text(str, expected) \
+do { \
+    check(looks_like_text(str, sizeof(str) - 1) == expected); \
+    check(looks_like_text_bytewise(str, sizeof(str) - 1) == expected); \
+} while (0)
+
+int main(void) {
+    check_text("", 1);
+    check_text("Hello, world!\n", 1);
+    /* Long enough to take the word-at-a-time path */
+    check_text("The quick brown fox jumps over the lazy dog, twice over.", 1);
+    check_text("tabs\tand\r\nline endings\f\v\b\a", 1);
+    check_text("\x1b[1mbold\x1b[0m", 1);
+
+    /* Control characters */
+    check_text("nul\0byte", 0);
+    check_text("a somewhat longer string with a nul\0 in the middle", 0);
+    check_text("delete\x7f", 0);
+    check_text("\x01", 0);
+
+    /* Valid UTF-8 */
+    check_text("caf\xc3\xa9", 1);
+    check_text("\xe2\x82\xac 100", 1);
+    check_text("\xf0\x9f\x98\x80", 1);
+    check_text("\xf4\x8f\xbf\xbf", 1);
+
+    /* Invalid UTF-8 */
+    check_text("\xff", 0);
+    check_text("\x80", 0);
+    /* Overlong encodings */
+    check_text("\xc0\xaf", 0);
+    check_text("\xe0\x80\xaf", 0);
+    check_text("\xf0\x80\x80\xaf", 0);
+    /* Surrogates */
+    check_text("\xed\xa0\x80", 0);
+    /* Above U+10FFFF */
+    check_text("\xf4\x90\x80\x80", 0);
+    /* Truncated sequences */
+    check_text("\xe2\x82", 0);
+    check_text("\xe2\x82 ", 0);
+    return 0;
+}
@@ -0,0 +1,137 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "test.h"
+
+#include "types/watch-sink.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+static char dir[] = "/tmp/wl-clipboard-test-XXXXXX";
+static char path[64];
+
+/* Returns a file with the given contents, rewound */
+static int data_file(const char *contents) {
+    FILE *f = tmpfile();
+    check(f != NULL);
+    check(fputs(contents, f) >= 0);
+    check(fflush(f) == 0);
+    int fd = dup(fileno(f));
+    fclose(f);
+    check(lseek(fd, 0, SEEK_SET) == 0);
+    return fd;
+}
+
+/* Reads whatever is available from the fd */
+static char *read_all(int fd) {
+    static char buffer[1024];
+    size_t length = 0;
+    ssize_t len;
+    while ((len = read(fd, buffer + length, sizeof(buffer) - length - 1)) > 0) {
+        length += len;
+    }
+    buffer[length] = 0;
+    return buffer;
+}
+
+static void test_append(void) {
+    snprintf(path, sizeof(path), "%s/append", dir);
+    struct watch_sink sink = {
+        .path = path,
+        .separator = "\0",
+        .separator_length = 1
+    };
+    watch_sink_init_append(&sink);
+
+    int fd = data_file("first");
+    check(watch_sink_write(&sink, fd, 5, "text/plain", "data", "seat0"));
+    close(fd);
+    fd = data_file("second");
+    check(watch_sink_write(&sink, fd, 6, "text/plain", "data", NULL));
+    close(fd);
+    /* A cleared selection doesn't append anything */
+    check(watch_sink_write(&sink, -1, 0, NULL, "nil", NULL));
+
+    fd = open(path, O_RDONLY);
+    check(fd >= 0);
+    char buffer[64];
+    ssize_t len = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    check(len == 13);
+    check(memcmp(buffer, "first\0second\0", 13) == 0);
+    unlink(path);
+}
+
+static void test_frames(void) {
+    snprintf(path, sizeof(path), "%s/fifo", dir);
+    check(mkfifo(path, 0600) == 0);
+    struct watch_sink sink = { .path = path };
+    watch_sink_init_socket(&sink);
+
+    /* Without a reader, the frame is dropped rather than blocking */
+    check(!watch_sink_write(&sink, -1, 0, NULL, "nil", NULL));
+
+    int reader = open(path, O_RDONLY | O_NONBLOCK);
+    check(reader >= 0);
+
+    int fd = data_file("hello");
+    check(watch_sink_write(&sink, fd, 5, "text/plain", "data", "seat0"));
+    close(fd);
+    check(strcmp(read_all(reader), "v2 text/plain data 5 seat0\nhello") == 0);
+
+    /* Spaces, control characters and percent signs get escaped */
+    fd = data_file("<b>");
+    check(watch_sink_write(
+        &sink,
+        fd,
+        3,
+        "text/html; charset=utf-8",
+        "sensitive",
+        "seat 100%\n"
+    ));
+    close(fd);
+    check(strcmp(
+        read_all(reader),
+        "v2 text/html;%20charset=utf-8 sensitive 3 seat%20100%25%0a\n<b>"
+    ) == 0);
+
+    /* Missing values are -, so an actual - gets escaped */
+    check(watch_sink_write(&sink, -1, 0, NULL, "nil", NULL));
+    check(strcmp(read_all(reader), "v2 - nil 0 -\n") == 0);
+    check(watch_sink_write(&sink, -1, 0, NULL, "nil", "-"));
+    check(strcmp(read_all(reader), "v2 - nil 0 %2d\n") == 0);
+
+    close(reader);
+    close(sink.fd);
+    unlink(path);
+}
+
+int main(void) {
+    /* The sinks expect this to be taken care of */
+    signal(SIGPIPE, SIG_IGN);
+    check(mkdtemp(dir) != NULL);
+    test_append();
+    test_frames();
+    rmdir(dir);
+    return 0;
+}
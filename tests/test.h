@@ -0,0 +1,39 @@
+/* wl-clipboard
+ *
+ * Copyright © 2018-2026 Sergey Bugaev <bugaevc@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TESTS_TEST_H
+#define TESTS_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Unlike assert(), this keeps working with NDEBUG */
+#define check(expr) \
+do { \
+    if (!(expr)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", \
+            __FILE__, __LINE__, #expr); \
+        exit(1); \
+    } \
+} while (0)
+
+/* The exit code meson treats as a skipped test */
+#define SKIP 77
+
+#endif /* TESTS_TEST_H */